@@ -1,8 +1,7 @@
 #include "ball.hpp"
+#include <algorithm>
 #include <iostream>
 
-const float g = 981.0f;
-
 Ball::Ball() 
     : radius(10.0f), position({400.0f, 400.0f}), velocity({0.0f, 0.0f}), color(RAYWHITE) 
 {}
@@ -11,10 +10,58 @@ Ball::Ball(float r, Vector2 pos, Vector2 vel, Color col)
     : radius(r), position(pos), velocity(vel), color(col) 
 {}
 
-void Ball::Update(float dt) {
-    if(!isDragged) {
-        velocity.y += (g * dt); // Simulate gravity effect
-        position = Vector2Add(position, Vector2Scale(velocity, dt));
+// Bounce speed off a wall: slow impacts come to rest instead of jittering
+static float Bounce(float speed, float restitution, float restingSpeed, bool& bounced) {
+    if (speed <= restingSpeed) return 0.0f;
+    bounced = true;
+    return -speed * restitution;
+}
+
+void Ball::Update(float dt, int screenWidth, int screenHeight) {
+    bounced = false;
+    prevPosition = position;
+    sweepStart = 0.0f;
+    restingSpeed = StepThreshold(RESTING_SPEED, dt);
+    bool wasGrounded = grounded;
+    grounded = false;
+    if(!isDragged && !asleep) {
+        velocity.y += (GRAVITY * dt); // Simulate gravity effect
+        if (wasGrounded) velocity.x *= expf(-GROUND_FRICTION * dt);
+
+        // Advance to the earliest wall hit, reflect, and spend the rest of the
+        // step with the new velocity. A ball already touching a wall hits it at t = 0.
+        float remaining = dt;
+        for (int event = 0; event < MAX_WALL_EVENTS && remaining > 0.0f; event++) {
+            float t = remaining;
+            int wall = -1;
+            auto hit = [&](float gap, float speed, int id) {
+                if (gap / speed < t) { t = gap / speed; wall = id; }
+            };
+            if (velocity.x < 0.0f) hit(radius - position.x, velocity.x, 0);
+            if (velocity.x > 0.0f) hit(screenWidth - radius - position.x, velocity.x, 1);
+            if (velocity.y < 0.0f) hit(radius - position.y, velocity.y, 2);
+            if (velocity.y > 0.0f) hit(screenHeight - radius - position.y, velocity.y, 3);
+            t = std::max(t, 0.0f);
+
+            position = Vector2Add(position, Vector2Scale(velocity, t));
+            remaining -= t;
+
+            if (wall < 0) break;
+            sweepStart = 1.0f - remaining / dt;
+            if (wall == 0) velocity.x = -Bounce(-velocity.x, restitution, restingSpeed, bounced);
+            if (wall == 1) velocity.x = Bounce(velocity.x, restitution, restingSpeed, bounced);
+            if (wall == 2) velocity.y = -Bounce(-velocity.y, restitution, restingSpeed, bounced);
+            if (wall == 3) {
+                velocity.y = Bounce(velocity.y, restitution, restingSpeed, bounced);
+                grounded = true;
+            }
+        }
+        if (remaining > 0.0f) position = Vector2Add(position, Vector2Scale(velocity, remaining));
+
+        // Keep the sweep a straight line that ends here with the final velocity,
+        // so ball-ball sweeps and EndStep see one consistent motion. Only the
+        // part after sweepStart is real; the line before it is extrapolated.
+        prevPosition = Vector2Subtract(position, Vector2Scale(velocity, dt));
     }
 }
 
@@ -23,16 +70,187 @@ void Ball::Draw() {
 }
 
 void Ball::CheckCollision(int screenWidth, int screenHeight) {
-    if(position.x - radius <= 0 || position.x + radius >= screenWidth) {
-        velocity.x *= -1 * restitution;
+    // Clamp back inside and only reflect velocity pointing into the wall,
+    // so a ball that ends a step outside cannot flip back and forth
+    if (position.x - radius <= 0) {
+        position.x = radius;
+        if (velocity.x < 0) velocity.x = -Bounce(-velocity.x, restitution, restingSpeed, bounced);
+    }
+    if (position.x + radius >= screenWidth) {
+        position.x = screenWidth - radius;
+        if (velocity.x > 0) velocity.x = Bounce(velocity.x, restitution, restingSpeed, bounced);
+    }
+    if (position.y - radius <= 0) {
+        position.y = radius;
+        if (velocity.y < 0) velocity.y = -Bounce(-velocity.y, restitution, restingSpeed, bounced);
+    }
+    if (position.y + radius >= screenHeight) {
+        position.y = screenHeight - radius;
+        if (velocity.y > 0) velocity.y = Bounce(velocity.y, restitution, restingSpeed, bounced);
+        grounded = true;
+    }
+}
+
+float Ball::Resolve(Ball& other, float invB) {
+    Vector2 delta = Vector2Subtract(other.position, position);
+    float minDist = radius + other.radius;
+    float dist2 = Vector2LengthSqr(delta);
+    if (dist2 >= minDist * minDist) return 0.0f;
+
+    // Mass scales with area; a dragged ball behaves as if it were pinned
+    float invA = isDragged ? 0.0f : 1.0f / (radius * radius);
+    float invSum = invA + invB;
+    if (invSum <= 0.0f) return 0.0f;
+
+    float dist = sqrtf(dist2);
+    Vector2 n = (dist > 1e-6f) ? Vector2Scale(delta, 1.0f / dist) : (Vector2){ 0.0f, -1.0f };
+
+    // Push the pair apart along the contact normal
+    float overlap = minDist - dist;
+    position       = Vector2Subtract(position, Vector2Scale(n, overlap * invA / invSum));
+    other.position = Vector2Add(other.position, Vector2Scale(n, overlap * invB / invSum));
+
+    // Cancel the approaching normal velocity. Only a fresh impact (the pair was
+    // apart when the step began) that is faster than the resting speed bounces;
+    // resting contacts in a pile stay perfectly inelastic
+    float vn = Vector2DotProduct(Vector2Subtract(other.velocity, velocity), n);
+    if (vn >= 0.0f) return 0.0f;
+
+    bool fresh = Vector2DistanceSqr(prevPosition, other.prevPosition) >= minDist * minDist;
+    float e = (fresh && -vn > std::max(restingSpeed, other.restingSpeed)) ? restitution : 0.0f;
+    float j = -(1.0f + e) * vn / invSum;
+    velocity       = Vector2Subtract(velocity, Vector2Scale(n, j * invA));
+    other.velocity = Vector2Add(other.velocity, Vector2Scale(n, j * invB));
+    if (e > 0.0f) {
+        bounced = true;
+        other.bounced = true;
+    }
+    return -vn;
+}
+
+float Ball::Collide(Ball& other) {
+    float invB = other.isDragged ? 0.0f : 1.0f / (other.radius * other.radius);
+    return Resolve(other, invB);
+}
+
+float Ball::CollideStatic(const Ball& other) {
+    if (!Touches(other, 0.0f)) return 0.0f;
+    Ball copy = other;   // the sleeper itself is never written
+    return Resolve(copy, 0.0f);
+}
+
+bool Ball::Touches(const Ball& other, float margin) const {
+    float reach = radius + other.radius + margin;
+    return Vector2DistanceSqr(position, other.position) < reach * reach;
+}
+
+Vector2 Ball::PositionAt(float s) const {
+    return Vector2Lerp(prevPosition, position, s);
+}
+
+bool Ball::IsFast() const {
+    return Vector2LengthSqr(Vector2Subtract(position, prevPosition)) > radius * radius;
+}
+
+float Ball::SweepTime(const Ball& other) const {
+    // Only search from where both balls are on their current straight paths
+    float s0 = std::max(sweepStart, other.sweepStart);
+
+    // Relative offset d(s0 + u) = d0 + dd * u; solve |d| = minDist for the first root
+    Vector2 motionA = Vector2Subtract(position, prevPosition);
+    Vector2 motionB = Vector2Subtract(other.position, other.prevPosition);
+    Vector2 d0 = Vector2Subtract(other.PositionAt(s0), PositionAt(s0));
+    Vector2 dd = Vector2Subtract(motionB, motionA);
+    float minDist = radius + other.radius;
+
+    float a = Vector2LengthSqr(dd);
+    float b = 2.0f * Vector2DotProduct(d0, dd);
+    float c = Vector2LengthSqr(d0) - minDist * minDist;
+    if (c <= 0.0f || a < 1e-8f || b >= 0.0f) return -1.0f;  // overlapping, still or separating
+
+    float disc = b * b - 4.0f * a * c;
+    if (disc < 0.0f) return -1.0f;
+
+    float s = s0 + (-b - sqrtf(disc)) / (2.0f * a);
+    return (s <= 1.0f) ? s : -1.0f;
+}
+
+float Ball::CollideSwept(Ball& other, float s, float dt, bool otherStatic) {
+    Vector2 pa = PositionAt(s);
+    Vector2 pb = otherStatic ? other.position : other.PositionAt(s);
+
+    float invA = isDragged ? 0.0f : 1.0f / (radius * radius);
+    float invB = (otherStatic || other.isDragged) ? 0.0f : 1.0f / (other.radius * other.radius);
+    float invSum = invA + invB;
+    if (invSum <= 0.0f) return 0.0f;
+
+    Vector2 delta = Vector2Subtract(pb, pa);
+    float dist = Vector2Length(delta);
+    Vector2 n = (dist > 1e-6f) ? Vector2Scale(delta, 1.0f / dist) : (Vector2){ 0.0f, -1.0f };
+
+    float vn = Vector2DotProduct(Vector2Subtract(other.velocity, velocity), n);
+    if (vn >= 0.0f) return 0.0f;
+
+    // A swept hit is always a fresh impact
+    float e = (-vn > std::max(restingSpeed, other.restingSpeed)) ? restitution : 0.0f;
+    float j = -(1.0f + e) * vn / invSum;
+    velocity = Vector2Subtract(velocity, Vector2Scale(n, j * invA));
+    if (e > 0.0f) bounced = true;
+
+    // Replay the remainder of the step from the contact point; the sweep start
+    // moves back along the new velocity so the sweep stays a straight line
+    position     = Vector2Add(pa, Vector2Scale(velocity, (1.0f - s) * dt));
+    prevPosition = Vector2Subtract(pa, Vector2Scale(velocity, s * dt));
+    sweepStart   = s;
+
+    if (!otherStatic) {
+        other.velocity = Vector2Add(other.velocity, Vector2Scale(n, j * invB));
+        if (e > 0.0f) other.bounced = true;
+        other.position     = Vector2Add(pb, Vector2Scale(other.velocity, (1.0f - s) * dt));
+        other.prevPosition = Vector2Subtract(pb, Vector2Scale(other.velocity, s * dt));
+        other.sweepStart   = s;
+    }
+    return -vn;
+}
+
+void Ball::EndStep(float dt) {
+    if (asleep) return;
+    // A ball held in place by a pile or wall cannot keep more speed than it
+    // actually moved with; otherwise deep stacks build up velocity that the
+    // iterations never get to cancel. Projection pushes never add speed.
+    if (!isDragged && !bounced && dt > 0.0f) {
+        Vector2 moved = Vector2Scale(Vector2Subtract(position, prevPosition), 1.0f / dt);
+        if (Vector2LengthSqr(moved) < Vector2LengthSqr(velocity)) velocity = moved;
+    }
+
+    // Resting means the mean velocity over the last SLEEP_STEPS steps stays
+    // below SLEEP_DRIFT / (SLEEP_STEPS * dt). Measuring drift from an anchor
+    // ignores the sub-pixel jitter a deep pile keeps at the velocity level.
+    if (isDragged || Vector2DistanceSqr(position, sleepAnchor) > SLEEP_DRIFT * SLEEP_DRIFT) {
+        sleepAnchor = position;
+        sleepTimer = 0;
+        return;
     }
-    if(position.y - radius <= 0 || position.y + radius >= screenHeight) {
-        velocity.y *= -1;
+    if (++sleepTimer >= SLEEP_STEPS) {
+        asleep = true;
+        velocity = { 0.0f, 0.0f };
     }
+}
+
+void Ball::Wake() {
+    asleep = false;
+    sleepTimer = 0;
+}
 
-}   
+void Ball::Sleep() {
+    asleep = true;
+    velocity = { 0.0f, 0.0f };
+    sleepAnchor = position;
+    sleepTimer = SLEEP_STEPS;
+}
 
 void Ball::ApplyForce(Vector2 force) {
+    Wake();
     velocity = Vector2Add(velocity, force);
 }
 
@@ -46,6 +264,8 @@ void Ball::HandleInput(Vector2 mousePos) {
     }
 
     if (isDragged) {
+        Wake();
+
         // Clamp position to window bounds while dragging
         int screenWidth = GetScreenWidth();
         int screenHeight = GetScreenHeight();
@@ -86,3 +306,9 @@ Vector2 Ball::GetVelocity() const {
 Color Ball::GetColor() const {
     return color;
 }
+bool Ball::IsAsleep() const {
+    return asleep;
+}
+bool Ball::IsDragged() const {
+    return isDragged;
+}
@@ -4,6 +4,25 @@
 #include <raymath.h>
 #include <vector>
 #include <cmath>
+#include <algorithm>
+
+const float GRAVITY = 981.0f;  // px/s^2
+
+// Sleep / resting-contact tuning (pixels and seconds)
+const float SLEEP_DRIFT   = 1.0f;           // a resting ball stays this close to where it settled
+const int   SLEEP_STEPS   = 60;             // resting steps before a ball falls asleep
+const float RESTING_SPEED = 30.0f;          // slower impacts do not bounce
+const float WAKE_SPEED    = RESTING_SPEED;  // closing speed that wakes a sleeping ball
+const float GROUND_FRICTION = 2.0f;         // 1/s, horizontal damping while on the floor
+
+// Continuous collision: wall hits handled per ball within one step
+const int   MAX_WALL_EVENTS = 4;
+
+// Gravity alone adds GRAVITY * dt of closing speed to every resting contact
+// each step, so with long steps the speed thresholds above have to grow with it
+inline float StepThreshold(float speed, float dt) {
+    return std::max(speed, 2.0f * GRAVITY * dt);
+}
 
 class Ball {
 private:
@@ -14,17 +33,49 @@ private:
     Color color;
     float restitution = 0.970f; // Coefficient of restitution (bounciness)
 
+    Vector2 prevPosition = { 0.0f, 0.0f };  // Position at the start of the step
+    float sweepStart = 0.0f;    // Fraction of the step where the current straight motion began
+    bool bounced = false;       // Took a restitution impulse this step
+    float restingSpeed = RESTING_SPEED;  // RESTING_SPEED scaled for the current step
+
+    bool asleep = false;        // Skipped by Update and treated as static by contacts
+    bool grounded = false;      // Touched the floor during the last collision pass
+    int sleepTimer = 0;         // Consecutive resting steps
+    Vector2 sleepAnchor = { 0.0f, 0.0f };  // Where the current resting run started
+
+    float Resolve(Ball& other, float invB);
+
 public:
     Ball();  // Default constructor
     Ball(float r, Vector2 pos, Vector2 vel, Color col);  // Custom constructor
 
-    void Update(float dt);
+    // Integrates one step and sweeps the motion against the walls, so a fast
+    // ball reflects at the moment it reaches a wall instead of ending the step outside
+    void Update(float dt, int screenWidth, int screenHeight);
     void Draw();
     
     void CheckCollision(int screenWidth, int screenHeight);
+    // Resolve overlap and bounce against another ball; returns the closing speed
+    float Collide(Ball& other);
+    float CollideStatic(const Ball& other);  // other is asleep and is not moved
+    bool Touches(const Ball& other, float margin) const;
+
+    // Swept test between this step's motions: fraction of the step at which
+    // the pair first touches, or -1 if they already touch or never do
+    float SweepTime(const Ball& other) const;
+    bool IsFast() const;  // moved further than its radius this step
+    Vector2 PositionAt(float s) const;  // along this step's sweep, s in [0, 1]
+    // Resolves a swept impact at fraction s and replays the rest of the step
+    // with the new velocities. A static other (asleep) is not moved.
+    float CollideSwept(Ball& other, float s, float dt, bool otherStatic);
+
     void ApplyForce(Vector2 force);
     void HandleInput(Vector2 mousePos);
 
+    void EndStep(float dt);  // call once per step after contacts are solved
+    void Wake();
+    void Sleep();  // puts the ball to sleep where it is, as EndStep would
+
     // Setters
     void SetRadius(float r);
     void SetPosition(Vector2 pos);
@@ -36,4 +87,6 @@ public:
     Vector2 GetPosition() const;
     Vector2 GetVelocity() const;
     Color GetColor() const;
+    bool IsAsleep() const;
+    bool IsDragged() const;
 };
@@ -1,6 +1,11 @@
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include "ball.hpp"
+#include "recording.hpp"
+#include "renderer.hpp"
+#include "replay.hpp"
+#include "world.hpp"
 
 int main() {
     std::cout << "Starting the game" << std::endl;
@@ -10,34 +15,145 @@ int main() {
 
     InitWindow(screen_width, screen_height, "Bouncing Ball Simulation");
     SetTargetFPS(120);
+    SetRandomSeed(1234);  // fixed seed + fixed step + fixed thread count -> repeatable runs
+
+    BallRenderer renderer;
+    renderer.Load();
+
+    World world(screen_width, screen_height);
 
     // Create multiple balls with different directions and speeds
-    std::vector<Ball> balls = {
-        Ball(15.0f, {100.0f, 100.0f}, {100.0f, 150.0f}, RED),
-        Ball(20.0f, {300.0f, 200.0f}, {-80.0f, 120.0f}, BLUE),
-        Ball(10.0f, {500.0f, 300.0f}, {60.0f, -100.0f}, GREEN),
-        Ball(25.0f, {200.0f, 600.0f}, {150.0f, -80.0f}, YELLOW),
-        Ball(18.0f, {700.0f, 400.0f}, {-120.0f, 90.0f}, ORANGE)
-    };
+    world.AddBall(Ball(15.0f, {100.0f, 100.0f}, {100.0f, 150.0f}, RED));
+    world.AddBall(Ball(20.0f, {300.0f, 200.0f}, {-80.0f, 120.0f}, BLUE));
+    world.AddBall(Ball(10.0f, {500.0f, 300.0f}, {60.0f, -100.0f}, GREEN));
+    world.AddBall(Ball(25.0f, {200.0f, 600.0f}, {150.0f, -80.0f}, YELLOW));
+    world.AddBall(Ball(18.0f, {700.0f, 400.0f}, {-120.0f, 90.0f}, ORANGE));
+
+    bool showSleeping = false;
+
+    // R records every step to disk, P switches to scrubbing the recording
+    const char* recordingPath = "recording.bbr";
+    Recorder recorder;
+    Replay replay;
+    std::vector<Ball> replayBalls;
+    bool replaying = false;
+    bool playing = false;
+    int replayFrame = 0;
+
+    const Color palette[] = { RED, BLUE, GREEN, YELLOW, ORANGE, SKYBLUE, PINK, LIME };
+
+    // Swept collisions keep fast balls from tunnelling at any step; the
+    // solver scales its iterations with the step to keep piles stable. At
+    // 1/30 s throws and bounces stay correct but deep piles keep jittering
+    // instead of falling asleep.
+    const float steps[] = { 1.0f / 120.0f, 1.0f / 60.0f, 1.0f / 30.0f };
+    int stepIndex = 1;
+    float dt = steps[stepIndex];
+    float accumulator = 0.0f;
 
     while (!WindowShouldClose()) {
-        float dt = GetFrameTime();
+        accumulator = std::min(accumulator + GetFrameTime(), 4 * dt);
+
+        if (IsKeyPressed(KEY_S)) showSleeping = !showSleeping;
+        // The step is fixed for a recording, which does not store it
+        if (IsKeyPressed(KEY_T) && !recorder.IsOpen() && !replaying) {
+            stepIndex = (stepIndex + 1) % 3;
+            dt = steps[stepIndex];
+        }
+        if (IsKeyPressed(KEY_R) && !replaying) {
+            if (recorder.IsOpen()) recorder.Close();
+            else recorder.Open(recordingPath);
+        }
+        if (IsKeyPressed(KEY_P)) {
+            if (replaying) {
+                replay.Close();
+                replaying = false;
+            } else {
+                recorder.Close();
+                replaying = replay.Open(recordingPath);
+                replayFrame = 0;
+                playing = false;
+            }
+        }
+
+        const Rectangle timeline = { 10.0f, screen_height - 30.0f, screen_width - 20.0f, 12.0f };
+
+        if (replaying) {
+            // Space plays in real time, arrows step (Shift: 100 frames),
+            // dragging along the timeline seeks anywhere in the run
+            const int last = replay.FrameCount() - 1;
+            if (IsKeyPressed(KEY_SPACE)) playing = !playing;
+            int stride = IsKeyDown(KEY_LEFT_SHIFT) ? 100 : 1;
+            if (IsKeyDown(KEY_RIGHT)) replayFrame += stride;
+            if (IsKeyDown(KEY_LEFT)) replayFrame -= stride;
+            while (accumulator >= dt) {
+                if (playing) replayFrame++;
+                accumulator -= dt;
+            }
+
+            Vector2 mouse = GetMousePosition();
+            if (IsMouseButtonDown(MOUSE_LEFT_BUTTON) && mouse.y >= timeline.y - 10.0f) {
+                replayFrame = (int)((mouse.x - timeline.x) / timeline.width * last + 0.5f);
+            }
+
+            replayFrame = std::min(std::max(replayFrame, 0), last);
+            if (replayFrame == last) playing = false;
+            replay.Load(replayFrame, replayBalls);
+        } else {
+            // Spawn a burst of small balls to stress the renderer
+            if (IsKeyPressed(KEY_B)) {
+                for (int i = 0; i < 1000; i++) {
+                    float r = (float)GetRandomValue(2, 6);
+                    Vector2 pos = { (float)GetRandomValue(10, screen_width - 10),
+                                    (float)GetRandomValue(10, screen_height / 2) };
+                    Vector2 vel = { (float)GetRandomValue(-200, 200),
+                                    (float)GetRandomValue(-200, 200) };
+                    world.AddBall(Ball(r, pos, vel, palette[GetRandomValue(0, 7)]));
+                }
+            }
+
+            world.HandleInput(GetMousePosition());
+
+            while (accumulator >= dt) {
+                world.Step(dt);
+                recorder.Capture(world.GetBalls());
+                accumulator -= dt;
+            }
+        }
 
         BeginDrawing();
         ClearBackground(DARKPURPLE);
 
-        DrawText("Click on a ball to drag it. Release to throw.", 10, 10, 20, LIGHTGRAY);
+        if (replaying) {
+            renderer.Draw(replayBalls, showSleeping);
+
+            float done = replay.FrameCount() > 1 ? (float)replayFrame / (replay.FrameCount() - 1) : 1.0f;
+            DrawRectangleRec(timeline, Fade(LIGHTGRAY, 0.3f));
+            DrawRectangle((int)timeline.x, (int)timeline.y, (int)(timeline.width * done), (int)timeline.height, LIGHTGRAY);
+
+            DrawText(TextFormat("REPLAY  frame %i / %i", replayFrame, replay.FrameCount() - 1), 10, 10, 20, LIGHTGRAY);
+            DrawText("Space: play/pause   Left/Right: step (Shift: x100)   drag bar: seek   P: live", 10, 35, 20, LIGHTGRAY);
+            DrawFPS(10, 60);
+        } else {
+            renderer.Draw(world.GetBalls(), showSleeping);
 
-        for (auto& ball : balls) {
-            ball.HandleInput(GetMousePosition());
-            ball.Update(dt);
-            ball.CheckCollision(screen_width, screen_height);
-            ball.Draw();
+            DrawText("Click on a ball to drag it. Release to throw.", 10, 10, 20, LIGHTGRAY);
+            DrawText(TextFormat("B: spawn 1000 balls   S: show sleeping   balls: %i  awake: %i",
+                                (int)world.GetBalls().size(), world.AwakeCount()), 10, 35, 20, LIGHTGRAY);
+            DrawText(TextFormat("solver threads: %i   R: record   P: replay   T: step 1/%i s", world.ThreadCount(),
+                                (int)(1.0f / dt + 0.5f)), 10, 60, 20, LIGHTGRAY);
+            DrawFPS(10, 85);
+            if (recorder.IsOpen()) {
+                DrawText(TextFormat("REC %i frames", (int)recorder.FrameCount()), screen_width - 190, 10, 20, RED);
+            }
         }
 
         EndDrawing();
     }
 
+    recorder.Close();
+    replay.Close();
+    renderer.Unload();
     CloseWindow();
     return 0;
 }
@@ -0,0 +1,150 @@
+#include "recording.hpp"
+#include <cstring>
+#include <iostream>
+
+Recorder::~Recorder() {
+    Close();
+}
+
+bool Recorder::Open(const std::string& path) {
+    Close();
+
+    file = fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Recorder: cannot open " << path << std::endl;
+        return false;
+    }
+
+    RecordingHeader header = { RECORDING_MAGIC, KEYFRAME_INTERVAL, POSITION_SCALE, VELOCITY_SCALE };
+    fwrite(&header, sizeof(header), 1, file);
+    offset = sizeof(header);
+
+    captured = 0;
+    knownBalls = 0;
+    previous.clear();
+    table.clear();
+    index.clear();
+    closing = false;
+    writer = std::thread(&Recorder::WriterLoop, this);
+    return true;
+}
+
+void Recorder::Capture(const std::vector<Ball>& balls) {
+    if (!file) return;
+
+    Snapshot s;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!spare.empty()) {
+            s = std::move(spare.back());
+            spare.pop_back();
+        }
+    }
+
+    s.state.resize(STATE_CHANNELS * balls.size());
+    for (size_t i = 0; i < balls.size(); i++) {
+        Vector2 p = balls[i].GetPosition();
+        Vector2 v = balls[i].GetVelocity();
+        uint16_t* out = s.state.data() + STATE_CHANNELS * i;
+        out[0] = QuantizePosition(p.x);
+        out[1] = QuantizePosition(p.y);
+        out[2] = QuantizeVelocity(v.x);
+        out[3] = QuantizeVelocity(v.y);
+        out[4] = balls[i].IsAsleep() ? STATE_ASLEEP : 0;
+    }
+
+    s.added.clear();
+    for (size_t i = knownBalls; i < balls.size(); i++) {
+        Color c = balls[i].GetColor();
+        s.added.push_back({ balls[i].GetRadius(), c.r, c.g, c.b, c.a });
+    }
+    knownBalls = balls.size();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(std::move(s));
+    }
+    ready.notify_one();
+    captured++;
+}
+
+void Recorder::WriterLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        ready.wait(lock, [this] { return closing || !pending.empty(); });
+        if (pending.empty()) return;   // closing and drained
+
+        Snapshot s = std::move(pending.front());
+        pending.pop_front();
+
+        lock.unlock();
+        WriteFrame(s);
+        lock.lock();
+
+        spare.push_back(std::move(s));
+    }
+}
+
+static void PutVarint(std::vector<uint8_t>& out, uint32_t v) {
+    while (v >= 0x80) {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+void Recorder::WriteFrame(const Snapshot& s) {
+    const bool keyframe = index.size() % KEYFRAME_INTERVAL == 0;
+    const size_t n = s.state.size();
+
+    payload.clear();
+    if (keyframe) {
+        payload.resize(n * sizeof(uint16_t));
+        memcpy(payload.data(), s.state.data(), payload.size());
+    } else {
+        // Balls new in this frame have no previous state and delta from 0
+        previous.resize(n, 0);
+        for (size_t k = 0; k < n; k++) {
+            int32_t d = (int32_t)s.state[k] - (int32_t)previous[k];
+            PutVarint(payload, ((uint32_t)d << 1) ^ (uint32_t)(d >> 31));
+        }
+    }
+    while (payload.size() % 4) payload.push_back(0);
+
+    size_t addedBytes = s.added.size() * sizeof(RecordedBall);
+    FrameHeader header = { (uint32_t)(payload.size() + addedBytes), (uint32_t)(n / STATE_CHANNELS),
+                           (uint32_t)s.added.size(), keyframe ? 1u : 0u };
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(payload.data(), 1, payload.size(), file);
+    if (addedBytes) fwrite(s.added.data(), 1, addedBytes, file);
+
+    index.push_back(offset);
+    offset += sizeof(header) + header.payloadBytes;
+    table.insert(table.end(), s.added.begin(), s.added.end());
+    previous = s.state;
+}
+
+void Recorder::Close() {
+    if (!file) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+    }
+    ready.notify_one();
+    writer.join();
+
+    RecordingFooter footer = {};
+    footer.tableOffset = offset;
+    fwrite(table.data(), sizeof(RecordedBall), table.size(), file);
+    footer.indexOffset = footer.tableOffset + table.size() * sizeof(RecordedBall);
+    fwrite(index.data(), sizeof(uint64_t), index.size(), file);
+    footer.ballCount = (uint32_t)table.size();
+    footer.frameCount = (uint32_t)index.size();
+    footer.magic = RECORDING_FOOTER;
+    fwrite(&footer, sizeof(footer), 1, file);
+
+    fclose(file);
+    file = nullptr;
+    spare.clear();
+}
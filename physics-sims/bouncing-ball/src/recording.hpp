@@ -0,0 +1,127 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ball.hpp"
+
+// Binary recording of ball state, one frame per simulation step.
+//
+// File layout (little endian, all records 4-byte aligned):
+//   RecordingHeader
+//   frames              FrameHeader, ball states, RecordedBall per new ball
+//   ball table          RecordedBall for every ball, in ball order
+//   frame index         uint64 file offset of every frame
+//   RecordingFooter     last bytes of the file
+//
+// A ball's state is STATE_CHANNELS uint16 values: x and y quantized to
+// 1/POSITION_SCALE px, vx and vy quantized to 1/VELOCITY_SCALE px/s around
+// VELOCITY_ZERO, and STATE_ASLEEP flags. Every KEYFRAME_INTERVAL-th frame
+// stores them as is; the frames between store the change of every channel
+// from the previous frame as zigzag varints, so a sleeping ball costs five
+// bytes. Balls added during a frame are described in that frame, so a
+// file whose footer never got written can be rebuilt by walking the frames.
+const uint32_t RECORDING_MAGIC  = 0x32524242;   // "BBR2"
+const uint32_t RECORDING_FOOTER = 0x58444e49;   // "INDX"
+const float    POSITION_SCALE   = 16.0f;
+const float    VELOCITY_SCALE   = 4.0f;         // +-8192 px/s in steps of 0.25
+const uint32_t VELOCITY_ZERO    = 32768;
+const uint32_t KEYFRAME_INTERVAL = 32;
+const int      STATE_CHANNELS   = 5;            // x, y, vx, vy, flags
+const uint16_t STATE_ASLEEP     = 1;
+
+struct RecordingHeader {
+    uint32_t magic;
+    uint32_t keyframeInterval;
+    float positionScale;
+    float velocityScale;
+};
+
+struct FrameHeader {
+    uint32_t payloadBytes;      // ball states + new balls, padded to 4 bytes
+    uint32_t ballCount;
+    uint32_t addedCount;        // balls first seen in this frame
+    uint32_t keyframe;          // 1: raw states, 0: deltas from the previous frame
+};
+
+struct RecordedBall {
+    float radius;
+    uint8_t r, g, b, a;
+};
+
+struct RecordingFooter {
+    uint64_t tableOffset;
+    uint64_t indexOffset;
+    uint32_t ballCount;
+    uint32_t frameCount;
+    uint32_t magic;
+    uint32_t reserved;
+};
+
+inline uint16_t QuantizePosition(float v) {
+    float q = v * POSITION_SCALE + 0.5f;
+    return (uint16_t)std::min(std::max(q, 0.0f), 65535.0f);
+}
+
+inline float DequantizePosition(uint16_t q) {
+    return q / POSITION_SCALE;
+}
+
+inline uint16_t QuantizeVelocity(float v) {
+    float q = v * VELOCITY_SCALE + VELOCITY_ZERO + 0.5f;
+    return (uint16_t)std::min(std::max(q, 0.0f), 65535.0f);
+}
+
+inline float DequantizeVelocity(uint16_t q) {
+    return ((int)q - (int)VELOCITY_ZERO) / VELOCITY_SCALE;
+}
+
+// Streams frames to disk from a background thread. Capture() only copies
+// quantized states into a recycled buffer, so the simulation thread never
+// waits on the file.
+class Recorder {
+private:
+    struct Snapshot {
+        std::vector<uint16_t> state;        // STATE_CHANNELS per ball
+        std::vector<RecordedBall> added;    // balls new since the last capture
+    };
+
+    FILE* file = nullptr;
+    std::thread writer;
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<Snapshot> pending;
+    std::vector<Snapshot> spare;            // written snapshots, reused by Capture
+    bool closing = false;
+
+    uint32_t captured = 0;                  // simulation side
+    size_t knownBalls = 0;
+
+    std::vector<uint16_t> previous;         // writer side
+    std::vector<RecordedBall> table;
+    std::vector<uint64_t> index;
+    std::vector<uint8_t> payload;
+    uint64_t offset = 0;
+
+    void WriterLoop();
+    void WriteFrame(const Snapshot& s);
+
+public:
+    Recorder() = default;
+    ~Recorder();
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+
+    bool Open(const std::string& path);
+    void Capture(const std::vector<Ball>& balls);
+    void Close();   // drains the queue, then writes the table, index and footer
+
+    bool IsOpen() const { return file != nullptr; }
+    uint32_t FrameCount() const { return captured; }
+};
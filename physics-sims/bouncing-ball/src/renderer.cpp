@@ -0,0 +1,54 @@
+#include "renderer.hpp"
+#include <rlgl.h>
+#include <cmath>
+
+void BallRenderer::Load(int resolution) {
+    Image img = GenImageColor(resolution, resolution, BLANK);
+    Color* pixels = (Color*)img.data;
+
+    // White disc with a one-pixel soft edge so scaled-down balls stay smooth
+    const float c = 0.5f * resolution;
+    for (int y = 0; y < resolution; y++) {
+        for (int x = 0; x < resolution; x++) {
+            float dx = x + 0.5f - c;
+            float dy = y + 0.5f - c;
+            float a = Clamp(c - sqrtf(dx*dx + dy*dy), 0.0f, 1.0f);
+            pixels[y * resolution + x] = { 255, 255, 255, (unsigned char)(a * 255.0f) };
+        }
+    }
+
+    circle = LoadTextureFromImage(img);
+    SetTextureFilter(circle, TEXTURE_FILTER_BILINEAR);
+    UnloadImage(img);
+}
+
+void BallRenderer::Unload() {
+    if (circle.id != 0) UnloadTexture(circle);
+    circle = {};
+}
+
+void BallRenderer::Draw(const std::vector<Ball>& balls, bool showSleeping) const {
+    if (balls.empty()) return;
+
+    rlSetTexture(circle.id);
+    rlBegin(RL_QUADS);
+    for (const Ball& ball : balls) {
+        // Flushes the batch (keeping texture and mode) once it is full
+        rlCheckRenderBatchLimit(4);
+
+        Vector2 p = ball.GetPosition();
+        float r = ball.GetRadius();
+        Color col = ball.GetColor();
+        if (showSleeping && ball.IsAsleep()) {
+            col = { (unsigned char)(col.r / 3), (unsigned char)(col.g / 3), (unsigned char)(col.b / 3), col.a };
+        }
+
+        rlColor4ub(col.r, col.g, col.b, col.a);
+        rlTexCoord2f(0.0f, 0.0f); rlVertex2f(p.x - r, p.y - r);
+        rlTexCoord2f(0.0f, 1.0f); rlVertex2f(p.x - r, p.y + r);
+        rlTexCoord2f(1.0f, 1.0f); rlVertex2f(p.x + r, p.y + r);
+        rlTexCoord2f(1.0f, 0.0f); rlVertex2f(p.x + r, p.y - r);
+    }
+    rlEnd();
+    rlSetTexture(0);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <raylib.h>
+#include <vector>
+#include "ball.hpp"
+
+// Draws every ball as a textured quad in a single rlgl batch.
+// The circle is rasterised once into a texture, so each ball costs
+// four vertices instead of a tessellated DrawCircleV fan.
+class BallRenderer {
+private:
+    Texture2D circle = {};
+
+public:
+    void Load(int resolution = 64);   // needs a GL context (after InitWindow)
+    void Unload();
+
+    // showSleeping dims sleeping balls so settled regions are visible
+    void Draw(const std::vector<Ball>& balls, bool showSleeping = false) const;
+};
@@ -0,0 +1,170 @@
+#include "replay.hpp"
+#include <cstring>
+#include <iostream>
+
+// Records in the mapping are only 4-byte aligned, so read through memcpy
+template <typename T>
+static T ReadAt(const uint8_t* p) {
+    T value;
+    memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+bool Replay::Open(const std::string& path) {
+    Close();
+
+    if (!file.Open(path)) {
+        std::cerr << "Replay: cannot map " << path << std::endl;
+        return false;
+    }
+    if (file.Size() < sizeof(RecordingHeader) ||
+        (header = ReadAt<RecordingHeader>(file.Data())).magic != RECORDING_MAGIC ||
+        header.keyframeInterval == 0) {
+        std::cerr << "Replay: " << path << " is not a recording" << std::endl;
+        Close();
+        return false;
+    }
+
+    bool indexed = false;
+    if (file.Size() >= sizeof(RecordingHeader) + sizeof(RecordingFooter)) {
+        RecordingFooter footer = ReadAt<RecordingFooter>(file.Data() + file.Size() - sizeof(RecordingFooter));
+        uint64_t indexEnd = footer.indexOffset + (uint64_t)footer.frameCount * sizeof(uint64_t);
+        indexed = footer.magic == RECORDING_FOOTER &&
+                  footer.tableOffset >= sizeof(RecordingHeader) &&
+                  footer.tableOffset + (uint64_t)footer.ballCount * sizeof(RecordedBall) == footer.indexOffset &&
+                  indexEnd + sizeof(RecordingFooter) == file.Size();
+        if (indexed) {
+            index = file.Data() + footer.indexOffset;
+            table = file.Data() + footer.tableOffset;
+            frameCount = (int)footer.frameCount;
+            ballCount = (int)footer.ballCount;
+        }
+
+        // Every indexed frame has to lie in front of the table; a damaged
+        // index is dropped and the frames walked as if it were missing
+        FrameHeader fh;
+        for (int f = 0; indexed && f < frameCount; f++) {
+            if (!ReadFrame(FrameOffset(f), footer.tableOffset, &fh)) {
+                std::cerr << "Replay: " << path << " has a damaged index" << std::endl;
+                indexed = false;
+                index = table = nullptr;
+                frameCount = ballCount = 0;
+            }
+        }
+    }
+
+    // The recorder was not closed cleanly: walk the frames once instead
+    if (!indexed && !Rebuild()) {
+        Close();
+        return false;
+    }
+    return frameCount > 0;
+}
+
+bool Replay::Rebuild() {
+    rebuiltIndex.clear();
+    rebuiltTable.clear();
+
+    uint64_t off = sizeof(RecordingHeader);
+    FrameHeader fh;
+    while (ReadFrame(off, file.Size(), &fh)) {   // stops at a frame cut off mid-write
+        uint64_t end = off + sizeof(FrameHeader) + fh.payloadBytes;
+        const uint8_t* added = file.Data() + end - fh.addedCount * sizeof(RecordedBall);
+        for (uint32_t k = 0; k < fh.addedCount; k++) {
+            rebuiltTable.push_back(ReadAt<RecordedBall>(added + k * sizeof(RecordedBall)));
+        }
+        rebuiltIndex.push_back(off);
+        off = end;
+    }
+
+    std::cerr << "Replay: no index, recovered " << rebuiltIndex.size() << " frames" << std::endl;
+    index = (const uint8_t*)rebuiltIndex.data();
+    table = (const uint8_t*)rebuiltTable.data();
+    frameCount = (int)rebuiltIndex.size();
+    ballCount = (int)rebuiltTable.size();
+    return frameCount > 0;
+}
+
+void Replay::Close() {
+    file.Close();
+    rebuiltIndex.clear();
+    rebuiltTable.clear();
+    index = nullptr;
+    table = nullptr;
+    frameCount = 0;
+    ballCount = 0;
+    decoded = -1;
+}
+
+uint64_t Replay::FrameOffset(int frame) const {
+    return ReadAt<uint64_t>(index + (size_t)frame * sizeof(uint64_t));
+}
+
+// Reads the header of the frame at offset and checks that the frame ends by
+// end and its payload can hold what the header promises: the new balls, and
+// the states as raw values or at least one varint byte each
+bool Replay::ReadFrame(uint64_t offset, uint64_t end, FrameHeader* fh) const {
+    if (offset < sizeof(RecordingHeader) || end > file.Size() || offset > end ||
+        end - offset < sizeof(FrameHeader)) return false;
+    *fh = ReadAt<FrameHeader>(file.Data() + offset);
+
+    uint64_t stateBytes = (uint64_t)fh->ballCount * STATE_CHANNELS * (fh->keyframe ? sizeof(uint16_t) : 1);
+    uint64_t addedBytes = (uint64_t)fh->addedCount * sizeof(RecordedBall);
+    return fh->payloadBytes <= end - offset - sizeof(FrameHeader) &&
+           stateBytes + addedBytes <= fh->payloadBytes;
+}
+
+void Replay::Decode(int frame) {
+    if (frame == decoded) return;
+
+    // Continue from the current frame when it lies on the way, otherwise
+    // restart from the keyframe that opens this frame's group
+    int key = frame - frame % (int)header.keyframeInterval;
+    int from = (decoded >= key && decoded < frame) ? decoded + 1 : key;
+
+    // Frames were checked by Open: states and new balls fit the payload.
+    // Varints are read no further than the states' end, so a corrupt delta
+    // garbles the replay but never reads outside the frame.
+    for (int f = from; f <= frame; f++) {
+        const uint8_t* p = file.Data() + FrameOffset(f);
+        FrameHeader fh = ReadAt<FrameHeader>(p);
+        p += sizeof(FrameHeader);
+        const uint8_t* end = p + fh.payloadBytes - (size_t)fh.addedCount * sizeof(RecordedBall);
+
+        const size_t n = STATE_CHANNELS * (size_t)fh.ballCount;
+        state.resize(n, 0);
+        if (fh.keyframe) {
+            memcpy(state.data(), p, n * sizeof(uint16_t));
+            continue;
+        }
+        for (size_t k = 0; k < n && p < end; k++) {
+            uint32_t v = 0;
+            for (int shift = 0; p < end && shift < 32; shift += 7) {
+                uint8_t byte = *p++;
+                v |= (uint32_t)(byte & 0x7f) << shift;
+                if (!(byte & 0x80)) break;
+            }
+            int32_t d = (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+            state[k] = (uint16_t)(state[k] + d);
+        }
+    }
+    decoded = frame;
+}
+
+void Replay::Load(int frame, std::vector<Ball>& balls) {
+    balls.clear();
+    if (frameCount == 0) return;
+
+    frame = std::min(std::max(frame, 0), frameCount - 1);
+    Decode(frame);
+
+    const int n = std::min((int)(state.size() / STATE_CHANNELS), ballCount);
+    for (int i = 0; i < n; i++) {
+        RecordedBall rb = ReadAt<RecordedBall>(table + i * sizeof(RecordedBall));
+        const uint16_t* in = state.data() + STATE_CHANNELS * i;
+        Vector2 pos = { DequantizePosition(in[0]), DequantizePosition(in[1]) };
+        Vector2 vel = { DequantizeVelocity(in[2]), DequantizeVelocity(in[3]) };
+        balls.emplace_back(rb.radius, pos, vel, (Color){ rb.r, rb.g, rb.b, rb.a });
+        if (in[4] & STATE_ASLEEP) balls.back().Sleep();
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ball.hpp"
+#include "mapped_file.hpp"
+#include "recording.hpp"
+
+// Random-access playback of a Recorder file.
+// The file is memory mapped and frames are located through the index, so
+// a seek decodes at most one keyframe and KEYFRAME_INTERVAL - 1 deltas no
+// matter how long the run was. Stepping forward one frame decodes a
+// single delta.
+class Replay {
+private:
+    MappedFile file;
+    RecordingHeader header = {};
+
+    std::vector<uint64_t> rebuiltIndex;         // only for files without a footer
+    std::vector<RecordedBall> rebuiltTable;
+    const uint8_t* index = nullptr;             // frameCount uint64 offsets
+    const uint8_t* table = nullptr;             // ballCount RecordedBall
+    int frameCount = 0;
+    int ballCount = 0;
+
+    std::vector<uint16_t> state;                // STATE_CHANNELS per ball of frame `decoded`
+    int decoded = -1;
+
+    uint64_t FrameOffset(int frame) const;
+    bool ReadFrame(uint64_t offset, uint64_t end, FrameHeader* fh) const;
+    bool Rebuild();
+    void Decode(int frame);
+
+public:
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() const { return file.IsOpen(); }
+    int FrameCount() const { return frameCount; }
+
+    // Fills balls with the state of the given frame (clamped to the valid range)
+    void Load(int frame, std::vector<Ball>& balls);
+};
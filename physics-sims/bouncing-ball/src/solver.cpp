@@ -0,0 +1,228 @@
+#include "solver.hpp"
+#include <algorithm>
+#include <cmath>
+
+// Sleeping balls closer than this are treated as resting on each other
+static const float TOUCH_MARGIN = 1.0f;
+
+CollisionSolver::CollisionSolver(ThreadPool& pool) : pool(pool) {}
+
+void CollisionSolver::InvalidateSleeping() {
+    sleepDirty = true;
+}
+
+int CollisionSolver::CellOf(Vector2 p) const {
+    int cx = std::min(std::max((int)(p.x / cellSize), 0), cols - 1);
+    int cy = std::min(std::max((int)(p.y / cellSize), 0), rows - 1);
+    return cy * cols + cx;
+}
+
+// Cells only ever grow, so a shrinking awake set does not force the static grid to rebuild
+void CollisionSolver::Resize(float maxRadius, int screenWidth, int screenHeight) {
+    if (2.0f * maxRadius <= cellSize && screenWidth == width && screenHeight == height) return;
+
+    cellSize = std::max(cellSize, 2.0f * maxRadius);
+    width = screenWidth;
+    height = screenHeight;
+    cols = std::max(1, (int)std::ceil(width / cellSize));
+    rows = std::max(1, (int)std::ceil(height / cellSize));
+    sleepDirty = true;
+}
+
+void CollisionSolver::Build(Grid& grid, const std::vector<Ball>& balls, const std::vector<int>& indices) {
+    const int n = (int)indices.size();
+    grid.start.assign(cols * rows + 1, 0);
+    grid.items.resize(n);
+    ballCell.resize(n);
+
+    // Counting sort by cell keeps balls in index-list order inside each bucket
+    for (int k = 0; k < n; k++) {
+        ballCell[k] = CellOf(balls[indices[k]].GetPosition());
+        grid.start[ballCell[k] + 1]++;
+    }
+    for (int c = 0; c < cols * rows; c++) grid.start[c + 1] += grid.start[c];
+
+    std::vector<int> fill(grid.start.begin(), grid.start.end() - 1);
+    for (int k = 0; k < n; k++) grid.items[fill[ballCell[k]]++] = indices[k];
+}
+
+void CollisionSolver::RebuildSleeping(const std::vector<Ball>& balls) {
+    std::vector<int> sleeping;
+    float maxRadius = 0.5f;
+    for (int i = 0; i < (int)balls.size(); i++) {
+        maxRadius = std::max(maxRadius, balls[i].GetRadius());
+        if (balls[i].IsAsleep()) sleeping.push_back(i);
+    }
+
+    Resize(maxRadius, width, height);
+    Build(sleepGrid, balls, sleeping);
+    sleepDirty = false;
+}
+
+void CollisionSolver::SolveCell(std::vector<Ball>& balls, int cx, int cy) {
+    static const int forward[4][2] = { {1, 0}, {-1, 1}, {0, 1}, {1, 1} };
+
+    const Grid& g = awakeGrid;
+    const Grid& s = sleepGrid;
+    const int c = cy * cols + cx;
+
+    for (int i = g.start[c]; i < g.start[c + 1]; i++) {
+        Ball& a = balls[g.items[i]];
+
+        for (int j = i + 1; j < g.start[c + 1]; j++) {
+            a.Collide(balls[g.items[j]]);
+        }
+
+        for (const auto& d : forward) {
+            int nx = cx + d[0], ny = cy + d[1];
+            if (nx < 0 || nx >= cols || ny >= rows) continue;
+
+            int nc = ny * cols + nx;
+            for (int j = g.start[nc]; j < g.start[nc + 1]; j++) {
+                a.Collide(balls[g.items[j]]);
+            }
+        }
+
+        // Sleepers are read-only here; every neighbour cell is checked because
+        // sleeper pairs are only ever seen from the awake side
+        for (int ny = std::max(cy - 1, 0); ny <= std::min(cy + 1, rows - 1); ny++) {
+            for (int nx = std::max(cx - 1, 0); nx <= std::min(cx + 1, cols - 1); nx++) {
+                int nc = ny * cols + nx;
+                for (int j = s.start[nc]; j < s.start[nc + 1]; j++) {
+                    const Ball& b = balls[s.items[j]];
+                    if (!b.IsAsleep()) continue;   // woken since the grid was built
+                    if (a.CollideStatic(b) > wakeSpeed) wakeQueue[cy].push_back(s.items[j]);
+                }
+            }
+        }
+    }
+}
+
+static float StepLength(const Ball& b) {
+    return Vector2Length(Vector2Subtract(b.PositionAt(1.0f), b.PositionAt(0.0f)));
+}
+
+// Sweeps every fast ball against the balls near its path and resolves the
+// earliest impact, repeating while the replayed motion hits something else.
+// Returns true if any ball was moved.
+bool CollisionSolver::SweepFast(std::vector<Ball>& balls, const std::vector<int>& awake, float maxRadius, float dt) {
+    bool moved = false;
+
+    // Partners are bucketed where they end the step, but may cross a's path
+    // anywhere along their own, up to their step length from that cell
+    float maxStep = 0.0f;
+    for (int i : awake) maxStep = std::max(maxStep, StepLength(balls[i]));
+
+    for (int i : awake) {
+        for (int event = 0; event < MAX_SWEEP_EVENTS && balls[i].IsFast(); event++) {
+            Ball& a = balls[i];
+
+            // Cells covering the swept path, padded by the largest partner
+            // and the longest step any partner takes
+            Vector2 p0 = a.PositionAt(0.0f), p1 = a.PositionAt(1.0f);
+            float pad = a.GetRadius() + 2.0f * maxRadius + maxStep;
+            int c0 = CellOf({ std::min(p0.x, p1.x) - pad, std::min(p0.y, p1.y) - pad });
+            int c1 = CellOf({ std::max(p0.x, p1.x) + pad, std::max(p0.y, p1.y) + pad });
+
+            float first = 2.0f;
+            int hit = -1;
+            bool hitStatic = false;
+            for (int cy = c0 / cols; cy <= c1 / cols; cy++) {
+                for (int cx = c0 % cols; cx <= c1 % cols; cx++) {
+                    int c = cy * cols + cx;
+                    for (int k = awakeGrid.start[c]; k < awakeGrid.start[c + 1]; k++) {
+                        int j = awakeGrid.items[k];
+                        if (j == i) continue;
+                        float s = a.SweepTime(balls[j]);
+                        if (s >= 0.0f && (s < first || (s == first && j < hit))) { first = s; hit = j; hitStatic = false; }
+                    }
+                    for (int k = sleepGrid.start[c]; k < sleepGrid.start[c + 1]; k++) {
+                        int j = sleepGrid.items[k];
+                        if (!balls[j].IsAsleep()) continue;
+                        float s = a.SweepTime(balls[j]);
+                        if (s >= 0.0f && (s < first || (s == first && j < hit))) { first = s; hit = j; hitStatic = true; }
+                    }
+                }
+            }
+            if (hit < 0) break;
+
+            float speed = a.CollideSwept(balls[hit], first, dt, hitStatic);
+            if (hitStatic && speed > wakeSpeed) sweepWakes.push_back(hit);
+            moved = true;
+
+            // An impact can send either ball further than anything before it
+            maxStep = std::max(maxStep, std::max(StepLength(a), StepLength(balls[hit])));
+        }
+    }
+    return moved;
+}
+
+void CollisionSolver::Solve(std::vector<Ball>& balls, std::vector<int>& awake, int screenWidth, int screenHeight, float dt) {
+    if (awake.empty()) return;
+
+    float maxRadius = 0.5f;
+    for (int i : awake) maxRadius = std::max(maxRadius, balls[i].GetRadius());
+    Resize(maxRadius, screenWidth, screenHeight);
+
+    if (sleepDirty) RebuildSleeping(balls);
+    Build(awakeGrid, balls, awake);
+
+    wakeQueue.resize(rows);
+    for (auto& q : wakeQueue) q.clear();
+    sweepWakes.clear();
+    wakeSpeed = StepThreshold(WAKE_SPEED, dt);
+
+    // Swept impacts move balls to where they end the step, so rebucket after
+    if (SweepFast(balls, awake, maxRadius, dt)) Build(awakeGrid, balls, awake);
+
+    const int wallChunk = 1024;
+    const int wallTasks = ((int)awake.size() + wallChunk - 1) / wallChunk;
+
+    const int passes = std::max(iterations, (int)std::ceil(iterations * dt / REFERENCE_STEP - 1e-3f));
+    for (int it = 0; it < passes; it++) {
+        for (int phase = 0; phase < PHASES; phase++) {
+            int taskRows = (rows - phase + PHASES - 1) / PHASES;
+            pool.ParallelFor(taskRows, [&](int t) {
+                int cy = phase + t * PHASES;
+                for (int cx = 0; cx < cols; cx++) SolveCell(balls, cx, cy);
+            });
+        }
+
+        // Walls inside the iteration loop let stacks settle against the floor
+        pool.ParallelFor(wallTasks, [&](int t) {
+            int end = std::min((t + 1) * wallChunk, (int)awake.size());
+            for (int k = t * wallChunk; k < end; k++) {
+                balls[awake[k]].CheckCollision(screenWidth, screenHeight);
+            }
+        });
+    }
+
+    for (int i : sweepWakes) Wake(balls, awake, i);
+    for (const auto& q : wakeQueue) {
+        for (int i : q) Wake(balls, awake, i);
+    }
+}
+
+void CollisionSolver::Wake(std::vector<Ball>& balls, std::vector<int>& awake, int index) {
+    if (!balls[index].IsAsleep()) return;
+    balls[index].Wake();
+    awake.push_back(index);
+}
+
+void CollisionSolver::WakeTouching(std::vector<Ball>& balls, std::vector<int>& awake, int index) {
+    if (sleepDirty) RebuildSleeping(balls);
+
+    const Ball& a = balls[index];
+    int c = CellOf(a.GetPosition());
+    int cx = c % cols, cy = c / cols;
+
+    for (int ny = std::max(cy - 1, 0); ny <= std::min(cy + 1, rows - 1); ny++) {
+        for (int nx = std::max(cx - 1, 0); nx <= std::min(cx + 1, cols - 1); nx++) {
+            int nc = ny * cols + nx;
+            for (int j = sleepGrid.start[nc]; j < sleepGrid.start[nc + 1]; j++) {
+                int k = sleepGrid.items[j];
+                if (balls[k].IsAsleep() && a.Touches(balls[k], TOUCH_MARGIN)) Wake(balls, awake, k);
+            }
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+#include "ball.hpp"
+#include "thread_pool.hpp"
+
+// Ball-ball contact solver.
+// Balls are bucketed into a uniform grid whose cells are at least one ball
+// diameter wide, so every contact is between a cell and one of its
+// neighbours. Each cell only pairs with itself and its forward neighbours
+// (right, down-left, down, down-right), so solving row cy only writes to
+// rows cy and cy+1. Rows are coloured by parity: one task solves a whole row
+// left to right, all even rows run in parallel, then all odd rows. Rows of
+// one colour never touch the same balls, and buckets are filled in ball
+// index order, so the result is identical for any thread count.
+//
+// Only awake balls are bucketed every step. Sleeping balls live in a second
+// grid that is rebuilt only when a ball falls asleep; they act as static
+// obstacles and are never written during the parallel phases. A hard impact
+// queues the sleeper for waking; waking then spreads one contact layer per
+// step through WakeTouching as woken balls start to move.
+//
+// Balls that move further than their radius in one step could pass straight
+// through a neighbour, so before the contact iterations they are swept against
+// every ball near their path. Partners are bucketed where they end the step,
+// so the search is padded by the longest step any awake ball takes. This pass is serial and runs in awake order;
+// fast balls are rare, and it keeps the result independent of thread count.
+class CollisionSolver {
+private:
+    static const int PHASES = 2;
+    static const int MAX_SWEEP_EVENTS = 4;   // swept impacts per fast ball per step
+
+    struct Grid {
+        std::vector<int> start;   // cols*rows + 1 offsets into items
+        std::vector<int> items;   // ball indices grouped by cell
+    };
+
+    ThreadPool& pool;
+
+    float cellSize = 1.0f;
+    int cols = 0;
+    int rows = 0;
+    int width = 0;
+    int height = 0;
+
+    Grid awakeGrid;
+    Grid sleepGrid;
+    bool sleepDirty = true;
+    float wakeSpeed = WAKE_SPEED;   // WAKE_SPEED scaled for the current step
+
+    std::vector<int> ballCell;                // scratch: cell of each bucketed ball
+    std::vector<std::vector<int>> wakeQueue;  // per row task, merged in row order
+    std::vector<int> sweepWakes;              // sleepers hit by fast balls
+
+    int CellOf(Vector2 p) const;
+    void Resize(float maxRadius, int screenWidth, int screenHeight);
+    void Build(Grid& grid, const std::vector<Ball>& balls, const std::vector<int>& indices);
+    void RebuildSleeping(const std::vector<Ball>& balls);
+    void SolveCell(std::vector<Ball>& balls, int cx, int cy);
+    bool SweepFast(std::vector<Ball>& balls, const std::vector<int>& awake, float maxRadius, float dt);
+
+public:
+    explicit CollisionSolver(ThreadPool& pool);
+
+    // Contact iterations per REFERENCE_STEP of simulated time. Longer steps
+    // run proportionally more, since a pile sinks further into itself per step.
+    static constexpr float REFERENCE_STEP = 1.0f / 120.0f;
+    int iterations = 8;
+
+    // Solves contacts and walls for the awake balls. Sleepers hit hard enough
+    // are woken and appended to awake.
+    void Solve(std::vector<Ball>& balls, std::vector<int>& awake, int screenWidth, int screenHeight, float dt);
+
+    // Wakes a sleeping ball and appends it to awake
+    void Wake(std::vector<Ball>& balls, std::vector<int>& awake, int index);
+
+    // Wakes every sleeping ball in contact with balls[index]
+    void WakeTouching(std::vector<Ball>& balls, std::vector<int>& awake, int index);
+
+    // Call after balls fall asleep so the static grid picks them up
+    void InvalidateSleeping();
+};
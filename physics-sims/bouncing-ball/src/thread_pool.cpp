@@ -0,0 +1,81 @@
+#include "thread_pool.hpp"
+
+ThreadPool::ThreadPool(int threads) {
+    if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+    if (threads <= 0) threads = 1;
+
+    threadCount = threads;
+    slices.reset(new Slice[threadCount]);
+
+    for (int i = 1; i < threadCount; i++) {
+        workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        quit = true;
+    }
+    wake.notify_all();
+    for (auto& t : workers) t.join();
+}
+
+int ThreadPool::Size() const {
+    return threadCount;
+}
+
+void ThreadPool::RunSlices(int id) {
+    const std::function<void(int)>& task = *job;
+
+    for (int k = 0; k < threadCount; k++) {
+        Slice& s = slices[(id + k) % threadCount];   // own slice first, then steal
+        for (int i = s.next.fetch_add(1); i < s.end; i = s.next.fetch_add(1)) {
+            task(i);
+        }
+    }
+}
+
+void ThreadPool::WorkerLoop(int id) {
+    unsigned seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            wake.wait(lock, [&] { return quit || generation != seen; });
+            if (quit) return;
+            seen = generation;
+        }
+
+        RunSlices(id);
+
+        std::lock_guard<std::mutex> lock(mtx);
+        if (--busy == 0) done.notify_one();
+    }
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int)>& task) {
+    if (count <= 0) return;
+    if (workers.empty() || count == 1) {
+        for (int i = 0; i < count; i++) task(i);
+        return;
+    }
+
+    for (int w = 0; w < threadCount; w++) {
+        slices[w].next.store((int)((long long)count * w / threadCount));
+        slices[w].end = (int)((long long)count * (w + 1) / threadCount);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        job = &task;
+        busy = (int)workers.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    RunSlices(0);
+
+    std::unique_lock<std::mutex> lock(mtx);
+    done.wait(lock, [&] { return busy == 0; });
+    job = nullptr;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker pool for data-parallel loops.
+// ParallelFor splits [0, count) into one slice per thread; a thread drains its
+// own slice first and then steals indices from the other slices, so uneven
+// tasks (dense vs empty cells) still keep every core busy.
+// The calling thread takes part as worker 0.
+class ThreadPool {
+private:
+    // Padded to a cache line so workers claiming from different slices
+    // do not contend on the same line
+    struct Slice {
+        std::atomic<int> next{0};
+        int end = 0;
+        char pad[64 - sizeof(std::atomic<int>) - sizeof(int)];
+    };
+
+    std::vector<std::thread> workers;
+    std::unique_ptr<Slice[]> slices;
+    int threadCount;
+
+    std::mutex mtx;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(int)>* job = nullptr;
+    unsigned generation = 0;
+    int busy = 0;
+    bool quit = false;
+
+    void WorkerLoop(int id);
+    void RunSlices(int id);
+
+public:
+    explicit ThreadPool(int threads = 0);  // 0 = one per hardware thread
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int Size() const;
+    void ParallelFor(int count, const std::function<void(int)>& task);
+};
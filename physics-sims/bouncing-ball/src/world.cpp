@@ -0,0 +1,91 @@
+#include "world.hpp"
+#include <algorithm>
+
+World::World(int screenWidth, int screenHeight, int threads)
+    : width(screenWidth), height(screenHeight), pool(threads), solver(pool)
+{}
+
+void World::AddBall(const Ball& ball) {
+    balls.push_back(ball);
+    awake.push_back((int)balls.size() - 1);
+}
+
+void World::ApplyForce(int index, Vector2 force) {
+    solver.Wake(balls, awake, index);
+    balls[index].ApplyForce(force);
+}
+
+void World::HandleInput(Vector2 mousePos) {
+    if (!IsMouseButtonDown(MOUSE_LEFT_BUTTON)) {
+        for (int i : held) balls[i].HandleInput(mousePos);   // releases the ball
+        held.clear();
+        return;
+    }
+
+    if (!held.empty()) {
+        for (int i : held) {
+            balls[i].HandleInput(mousePos);
+            solver.WakeTouching(balls, awake, i);
+        }
+        return;
+    }
+
+    // Nothing grabbed yet: look for balls under the cursor
+    for (int i = 0; i < (int)balls.size(); i++) {
+        if (Vector2Distance(mousePos, balls[i].GetPosition()) > balls[i].GetRadius()) continue;
+
+        solver.Wake(balls, awake, i);
+        balls[i].HandleInput(mousePos);
+        held.push_back(i);
+    }
+
+    // A dragged ball shoves whatever it is pushed into
+    for (int i : held) solver.WakeTouching(balls, awake, i);
+}
+
+void World::Step(float dt) {
+    const int chunk = 1024;
+    const int tasks = ((int)awake.size() + chunk - 1) / chunk;
+    pool.ParallelFor(tasks, [&](int t) {
+        int end = std::min((t + 1) * chunk, (int)awake.size());
+        for (int k = t * chunk; k < end; k++) balls[awake[k]].Update(dt, width, height);
+    });
+
+    solver.Solve(balls, awake, width, height, dt);
+
+    // Retire balls that have rested long enough
+    bool fellAsleep = false;
+    size_t kept = 0;
+    for (size_t k = 0; k < awake.size(); k++) {
+        Ball& b = balls[awake[k]];
+        b.EndStep(dt);
+        if (b.IsAsleep()) fellAsleep = true;
+        else awake[kept++] = awake[k];
+    }
+    awake.resize(kept);
+
+    if (fellAsleep) solver.InvalidateSleeping();
+
+    // Fast-moving balls wake the sleepers they touch: knocking a ball out of a
+    // pile lets the balls it supported fall, one contact layer per step
+    const float wakeSpeed = StepThreshold(WAKE_SPEED, dt);
+    const size_t moving = awake.size();
+    for (size_t k = 0; k < moving; k++) {
+        int i = awake[k];
+        if (Vector2LengthSqr(balls[i].GetVelocity()) > wakeSpeed * wakeSpeed) {
+            solver.WakeTouching(balls, awake, i);
+        }
+    }
+}
+
+const std::vector<Ball>& World::GetBalls() const {
+    return balls;
+}
+
+int World::AwakeCount() const {
+    return (int)awake.size();
+}
+
+int World::ThreadCount() const {
+    return pool.Size();
+}
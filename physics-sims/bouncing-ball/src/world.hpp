@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include "ball.hpp"
+#include "solver.hpp"
+#include "thread_pool.hpp"
+
+// Owns the balls and steps only the awake ones.
+// Sleeping balls cost nothing per step until a contact, a drag or
+// ApplyForce wakes them again.
+class World {
+private:
+    int width;
+    int height;
+
+    std::vector<Ball> balls;
+    std::vector<int> awake;   // indices of balls integrated every step
+    std::vector<int> held;    // balls currently dragged by the mouse
+
+    ThreadPool pool;
+    CollisionSolver solver;
+
+public:
+    World(int screenWidth, int screenHeight, int threads = 0);
+
+    void AddBall(const Ball& ball);
+    void ApplyForce(int index, Vector2 force);
+    void HandleInput(Vector2 mousePos);
+    void Step(float dt);
+
+    const std::vector<Ball>& GetBalls() const;
+    int AwakeCount() const;
+    int ThreadCount() const;
+};
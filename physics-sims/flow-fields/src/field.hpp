@@ -0,0 +1,319 @@
+#pragma once
+#include <raylib.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+#include "perlin.hpp"
+
+// Wind fields built from components. A component is a plain struct with
+// its parameters as members and
+//
+//     static constexpr bool isField = true;
+//     Vector3 operator()(Vector3 p, float t) const;
+//
+// and optionally a batch form that adds the field at many points at once:
+//
+//     void addBatch(const float* x, const float* y, const float* z, int count,
+//                   float t, float* fx, float* fy, float* fz) const;
+//
+// Components are combined with + and scaled with *. The result is a type
+// that names every part, so the compiler sees the whole field and inlines
+// it into the particle update: no call through a pointer per sample, and
+// the batch form runs one loop per component over a whole chunk.
+//
+// Parameters stay ordinary members in every form, so a running program can
+// tune them live. DynamicField holds components chosen at run time, for
+// scenarios that are not known when building.
+namespace wind {
+
+// ---- helpers ----
+inline Vector3 SafeNormalize(Vector3 v) {
+    float m = sqrtf(v.x*v.x + v.y*v.y + v.z*v.z);
+    if (m < 1e-6f) return { 0, 0, 0 };
+    float inv = 1.0f / m;
+    return { v.x * inv, v.y * inv, v.z * inv };
+}
+
+// 1 inside coreR, smoothstep down to 0 at outerR
+inline float Falloff(float r, float coreR, float outerR) {
+    if (r <= coreR) return 1.0f;
+    if (r >= outerR) return 0.0f;
+    float t = (r - coreR) / (outerR - coreR); // 0..1
+    float s = 1.0f - t;
+    return s * s * (3.0f - 2.0f * s);         // smoothstep
+}
+
+inline float ClampF(float v, float lo, float hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+template <typename F, typename = void>
+struct IsField : std::false_type {};
+template <typename F>
+struct IsField<F, std::enable_if_t<F::isField>> : std::true_type {};
+
+template <typename F, typename = void>
+struct HasBatch : std::false_type {};
+template <typename F>
+struct HasBatch<F, std::void_t<decltype(std::declval<const F&>().addBatch(
+    (const float*)nullptr, (const float*)nullptr, (const float*)nullptr, 0, 0.0f,
+    (float*)nullptr, (float*)nullptr, (float*)nullptr))>> : std::true_type {};
+
+// Adds field f at count points to (fx, fy, fz)
+template <typename F>
+inline void addBatch(const F& f, const float* x, const float* y, const float* z, int count,
+                     float t, float* fx, float* fy, float* fz) {
+    if constexpr (HasBatch<F>::value) {
+        f.addBatch(x, y, z, count, t, fx, fy, fz);
+    } else {
+        for (int i = 0; i < count; ++i) {
+            Vector3 w = f(Vector3{ x[i], y[i], z[i] }, t);
+            fx[i] += w.x; fy[i] += w.y; fz[i] += w.z;
+        }
+    }
+}
+
+// Writes field f at count points to (fx, fy, fz)
+template <typename F>
+inline void sample(const F& f, const float* x, const float* y, const float* z, int count,
+                   float t, float* fx, float* fy, float* fz) {
+    for (int i = 0; i < count; ++i) fx[i] = fy[i] = fz[i] = 0.0f;
+    addBatch(f, x, y, z, count, t, fx, fy, fz);
+}
+
+// Batch sampling behind a std::function, for code that is not a template;
+// one call per chunk or row, so the indirection is not per point
+using SampleFn = std::function<void(const float* x, const float* y, const float* z, int count,
+                                    float t, float* fx, float* fy, float* fz)>;
+
+template <typename F>
+SampleFn sampler(const F& f) {
+    return [&f](const float* x, const float* y, const float* z, int count,
+                float t, float* fx, float* fy, float* fz) {
+        sample(f, x, y, z, count, t, fx, fy, fz);
+    };
+}
+
+// ---- components ----
+
+// The same wind everywhere
+struct Uniform {
+    static constexpr bool isField = true;
+    Vector3 velocity{ 0, 0, 0 };
+
+    Vector3 operator()(Vector3, float) const { return velocity; }
+};
+
+// Wind that changes linearly with height: base + perHeight * (y - originY)
+struct Shear {
+    static constexpr bool isField = true;
+    Vector3 base{ 0.32f, 0, 0.56f };
+    Vector3 perHeight{ 0.016f, 0, 0 };
+    float originY = 0.0f;
+
+    Vector3 operator()(Vector3 p, float) const {
+        float h = p.y - originY;
+        return { base.x + perHeight.x * h, base.y + perHeight.y * h, base.z + perHeight.z * h };
+    }
+};
+
+// Tornado around a vertical axis through center: swirl around it, inflow
+// toward it and updraft along it, all fading out between coreR and outerR.
+// Inflow weakens with height and updraft strengthens.
+struct Vortex {
+    static constexpr bool isField = true;
+    Vector3 center{ 0, 0, 0 };
+    float coreR   = 12.0f;
+    float outerR  = 90.0f;
+    float swirl   = 9.0f;
+    float inflow  = 4.0f;
+    float updraft = 7.0f;
+
+    Vector3 operator()(Vector3 p, float) const {
+        Vector3 q = { p.x - center.x, p.y - center.y, p.z - center.z };
+        float r = sqrtf(q.x*q.x + q.z*q.z);
+
+        Vector3 radial = SafeNormalize({ q.x, 0.0f, q.z });
+        Vector3 tang   = { -radial.z, 0.0f, radial.x };
+
+        float f = Falloff(r, coreR, outerR);
+
+        // Core shaping so r->0 doesn't explode
+        float coreShape = r / (r + coreR);
+
+        // Slight altitude shaping (fits a box of y in [-50,50])
+        float y = q.y;
+        float inflowY = ClampF(1.0f - (y + 10.0f) / 80.0f, 0.25f, 1.0f);
+        float upY     = ClampF(0.7f + (y + 10.0f) / 120.0f, 0.5f, 1.4f);
+
+        float s = swirl * f * (0.6f + 1.0f*coreShape);
+        float i = -inflow * f * inflowY;
+        float u = updraft * f * upY;
+        return { tang.x * s + radial.x * i, u, tang.z * s + radial.z * i };
+    }
+};
+
+// Outward flow from center (inward for negative strength), strongest at
+// `radius` from it and fading with distance beyond
+struct PointSource {
+    static constexpr bool isField = true;
+    Vector3 center{ 0, 0, 0 };
+    float strength = 5.0f;
+    float radius   = 10.0f;
+
+    Vector3 operator()(Vector3 p, float) const {
+        Vector3 d = { p.x - center.x, p.y - center.y, p.z - center.z };
+        float k = 2.0f * strength * radius / (d.x*d.x + d.y*d.y + d.z*d.z + radius*radius);
+        return { d.x * k, d.y * k, d.z * k };
+    }
+};
+
+// Small fBm perturbation of fixed length `strength`, fading like a vortex
+// between coreR and outerR around center (outerR <= 0: everywhere)
+struct Turbulence {
+    static constexpr bool isField = true;
+    Vector3 center{ 0, 0, 0 };
+    float coreR    = 12.0f;
+    float outerR   = 90.0f;
+    float strength = 0.45f;   // keep low so it doesn't look random
+    float scale    = 0.03f;   // noise spatial scale for ~100-unit world
+    float speed    = 0.25f;   // noise time speed
+    float vertical = 0.25f;   // share of the vertical component
+    int octaves    = 5;
+    const noise::Perlin* noise = &noise::defaultNoise();
+
+    float weight(Vector3 p) const {
+        if (outerR <= 0.0f) return 1.0f;
+        float dx = p.x - center.x, dz = p.z - center.z;
+        return Falloff(sqrtf(dx*dx + dz*dz), coreR, outerR);
+    }
+
+    Vector3 operator()(Vector3 p, float t) const {
+        float tx = noise->fbm3(p.x*scale + 13.1f, p.y*scale + 7.7f,  p.z*scale + t*speed, octaves, 2.0f, 0.5f);
+        float ty = noise->fbm3(p.x*scale + 21.4f, p.y*scale + 19.2f, p.z*scale + t*speed, octaves, 2.0f, 0.5f);
+        float tz = noise->fbm3(p.x*scale + 5.6f,  p.y*scale + 31.8f, p.z*scale + t*speed, octaves, 2.0f, 0.5f);
+
+        Vector3 d = SafeNormalize({ tx, vertical*ty, tz });
+        float s = strength * weight(p);
+        return { d.x * s, d.y * s, d.z * s };
+    }
+
+    // Through the batch noise, a block of points at a time
+    void addBatch(const float* x, const float* y, const float* z, int count,
+                  float t, float* fx, float* fy, float* fz) const {
+        const int BLOCK = 64;
+        static const float OFFSETS[3][2] = { { 13.1f, 7.7f }, { 21.4f, 19.2f }, { 5.6f, 31.8f } };
+        float sx[BLOCK], sy[BLOCK], sz[BLOCK], n[3][BLOCK];
+        for (int b = 0; b < count; b += BLOCK) {
+            const int m = std::min(BLOCK, count - b);
+            for (int i = 0; i < m; ++i) sz[i] = z[b + i]*scale + t*speed;
+            for (int k = 0; k < 3; ++k) {
+                for (int i = 0; i < m; ++i) {
+                    sx[i] = x[b + i]*scale + OFFSETS[k][0];
+                    sy[i] = y[b + i]*scale + OFFSETS[k][1];
+                }
+                noise->fbm3(sx, sy, sz, n[k], m, octaves, 2.0f, 0.5f);
+            }
+            for (int i = 0; i < m; ++i) {
+                Vector3 d = SafeNormalize({ n[0][i], vertical*n[1][i], n[2][i] });
+                float s = strength * weight({ x[b + i], y[b + i], z[b + i] });
+                fx[b + i] += d.x * s; fy[b + i] += d.y * s; fz[b + i] += d.z * s;
+            }
+        }
+    }
+};
+
+// ---- composition ----
+
+// Sum of fields, evaluated left to right
+template <typename... Fs>
+struct Sum {
+    static constexpr bool isField = true;
+    std::tuple<Fs...> parts;
+
+    // The part of type F, to tune it
+    template <typename F> F& part() { return std::get<F>(parts); }
+    template <typename F> const F& part() const { return std::get<F>(parts); }
+
+    Vector3 operator()(Vector3 p, float t) const {
+        Vector3 w = { 0, 0, 0 };
+        std::apply([&](const Fs&... f) {
+            ((w = add(w, f(p, t))), ...);
+        }, parts);
+        return w;
+    }
+
+    void addBatch(const float* x, const float* y, const float* z, int count,
+                  float t, float* fx, float* fy, float* fz) const {
+        std::apply([&](const Fs&... f) {
+            (wind::addBatch(f, x, y, z, count, t, fx, fy, fz), ...);
+        }, parts);
+    }
+
+private:
+    static Vector3 add(Vector3 a, Vector3 b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+};
+
+// A field times a constant
+template <typename F>
+struct Scaled {
+    static constexpr bool isField = true;
+    F field;
+    float k = 1.0f;
+
+    Vector3 operator()(Vector3 p, float t) const {
+        Vector3 w = field(p, t);
+        return { w.x * k, w.y * k, w.z * k };
+    }
+};
+
+template <typename A, typename B, typename = std::enable_if_t<IsField<A>::value && IsField<B>::value>>
+Sum<A, B> operator+(const A& a, const B& b) { return { { a, b } }; }
+
+template <typename... As, typename B, typename = std::enable_if_t<IsField<B>::value>>
+Sum<As..., B> operator+(const Sum<As...>& a, const B& b) {
+    return { std::tuple_cat(a.parts, std::tuple<B>(b)) };
+}
+
+template <typename F, typename = std::enable_if_t<IsField<F>::value>>
+Scaled<F> operator*(float k, const F& f) { return { f, k }; }
+
+template <typename F, typename = std::enable_if_t<IsField<F>::value>>
+Scaled<F> operator*(const F& f, float k) { return { f, k }; }
+
+// ---- runtime fields ----
+
+// Components picked at run time: each one is still evaluated a whole batch
+// at a time, so the dispatch costs one visit per component per batch
+using Component = std::variant<Uniform, Shear, Vortex, PointSource, Turbulence>;
+
+struct DynamicField {
+    static constexpr bool isField = true;
+    std::vector<Component> parts;
+
+    void add(const Component& c) { parts.push_back(c); }
+    void clear() { parts.clear(); }
+
+    Vector3 operator()(Vector3 p, float t) const {
+        Vector3 w = { 0, 0, 0 };
+        for (const Component& c : parts) {
+            Vector3 v = std::visit([&](const auto& f) { return f(p, t); }, c);
+            w = { w.x + v.x, w.y + v.y, w.z + v.z };
+        }
+        return w;
+    }
+
+    void addBatch(const float* x, const float* y, const float* z, int count,
+                  float t, float* fx, float* fy, float* fz) const {
+        for (const Component& c : parts) {
+            std::visit([&](const auto& f) { wind::addBatch(f, x, y, z, count, t, fx, fy, fz); }, c);
+        }
+    }
+};
+
+}
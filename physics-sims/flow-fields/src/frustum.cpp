@@ -0,0 +1,48 @@
+#include "frustum.hpp"
+#include <raymath.h>
+#include <cmath>
+
+// Plane with normal n (not necessarily unit length) through point p
+static Vector4 PlaneThrough(Vector3 n, Vector3 p) {
+    n = Vector3Normalize(n);
+    return { n.x, n.y, n.z, -Vector3DotProduct(n, p) };
+}
+
+Frustum Frustum::fromCamera(const Camera3D& cam, float aspect, float nearZ, float farZ) {
+    Vector3 f = Vector3Normalize(Vector3Subtract(cam.target, cam.position));
+    Vector3 r = Vector3Normalize(Vector3CrossProduct(f, cam.up));
+    Vector3 u = Vector3CrossProduct(r, f);
+    Vector3 eye = cam.position;
+
+    Frustum fr;
+    if (cam.projection == CAMERA_ORTHOGRAPHIC) {
+        // fovy is the height of the view in world units
+        float hy = 0.5f * cam.fovy, hx = hy * aspect;
+        fr.planes[0] = PlaneThrough(r, Vector3Subtract(eye, Vector3Scale(r, hx)));
+        fr.planes[1] = PlaneThrough(Vector3Negate(r), Vector3Add(eye, Vector3Scale(r, hx)));
+        fr.planes[2] = PlaneThrough(u, Vector3Subtract(eye, Vector3Scale(u, hy)));
+        fr.planes[3] = PlaneThrough(Vector3Negate(u), Vector3Add(eye, Vector3Scale(u, hy)));
+    } else {
+        // A side plane holds the eye, the edge direction f + r tan and the
+        // other screen axis; f tan - r is normal to both edge and axis
+        float ty = tanf(0.5f * cam.fovy * DEG2RAD), tx = ty * aspect;
+        fr.planes[0] = PlaneThrough(Vector3Add(Vector3Scale(f, tx), r), eye);
+        fr.planes[1] = PlaneThrough(Vector3Subtract(Vector3Scale(f, tx), r), eye);
+        fr.planes[2] = PlaneThrough(Vector3Add(Vector3Scale(f, ty), u), eye);
+        fr.planes[3] = PlaneThrough(Vector3Subtract(Vector3Scale(f, ty), u), eye);
+    }
+    fr.planes[4] = PlaneThrough(f, Vector3Add(eye, Vector3Scale(f, nearZ)));
+    fr.planes[5] = PlaneThrough(Vector3Negate(f), Vector3Add(eye, Vector3Scale(f, farZ)));
+    return fr;
+}
+
+bool Frustum::intersects(const BoundingBox& b) const {
+    for (const Vector4& p : planes) {
+        // The box corner furthest along the normal
+        float x = (p.x >= 0.0f) ? b.max.x : b.min.x;
+        float y = (p.y >= 0.0f) ? b.max.y : b.min.y;
+        float z = (p.z >= 0.0f) ? b.max.z : b.min.z;
+        if (p.x * x + p.y * y + p.z * z + p.w < 0.0f) return false;
+    }
+    return true;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <raylib.h>
+
+// The six planes bounding what a camera sees. Each plane keeps points with
+// n.x * x + n.y * y + n.z * z + d >= 0; n points into the view volume.
+struct Frustum {
+    Vector4 planes[6];   // left, right, bottom, top, near, far
+
+    // aspect is width / height of the viewport; nearZ and farZ are the clip
+    // distances along the view direction
+    static Frustum fromCamera(const Camera3D& cam, float aspect, float nearZ, float farZ);
+
+    // false only if the box is entirely outside one plane; boxes crossing
+    // a corner of the frustum may pass
+    bool intersects(const BoundingBox& b) const;
+};
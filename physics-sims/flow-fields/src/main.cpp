@@ -3,83 +3,50 @@
 #include <raymath.h>
 
 #include "particle.hpp"
+#include "field.hpp"
 #include "perlin.hpp"
+#include "renderer.hpp"
+#include "thread_pool.hpp"
+#include "trail.hpp"
+#include "wind_grid.hpp"
 
 #include <vector>
 #include <algorithm>
 
 /* build:
-g++ src/perlin.cpp src/particle.cpp src/main.cpp -o main.exe -lraylib -lopengl32 -lgdi32 -lwinmm
+g++ src/perlin.cpp src/particle.cpp src/trail.cpp src/thread_pool.cpp src/wind_grid.cpp src/renderer.cpp src/frustum.cpp src/main.cpp -o main.exe -O2 -mavx2 -mfma -lraylib -lopengl32 -lgdi32 -lwinmm
 */
 
-static inline Vector3 SafeNormalize(Vector3 v) {
-    float m = Vector3Length(v);
-    return (m < 1e-6f) ? (Vector3){0,0,0} : Vector3Scale(v, 1.0f / m);
-}
+// Tornado + weather: base vortex dominates, noise is just turbulence.
+// The component defaults are tuned for the big box.
+using Tornado = wind::Sum<wind::Vortex, wind::Shear, wind::Turbulence>;
 
-static inline float Falloff(float r, float coreR, float outerR) {
-    if (r <= coreR) return 1.0f;
-    if (r >= outerR) return 0.0f;
-    float t = (r - coreR) / (outerR - coreR); // 0..1
-    float s = 1.0f - t;
-    return s * s * (3.0f - 2.0f * s);         // smoothstep
+static Tornado MakeTornado() {
+    return wind::Vortex{} + wind::Shear{} + wind::Turbulence{};
 }
 
-// Tornado + weather: base vortex dominates, noise is just turbulence
-static Vector3 SampleWind(Vector3 p, float t)
-{
-    // --- match your big box scale ---
-    const Vector3 c = {0,0,0};
-    const float coreR  = 12.0f;
-    const float outerR = 90.0f;
-
-    const float swirlS   = 9.0f;
-    const float inflowS  = 4.0f;
-    const float updraftS = 7.0f;
-    const float shearS   = 1.6f;
-
-    const float turbS = 0.45f;   // keep low so it doesn't look random
-    const float ns = 0.03f;      // noise spatial scale for ~100-unit world
-    const float nt = 0.25f;      // noise time speed
-
-    Vector3 q = Vector3Subtract(p, c);
-    float r = sqrtf(q.x*q.x + q.z*q.z);
-
-    Vector3 radial = SafeNormalize((Vector3){q.x, 0.0f, q.z});
-    Vector3 tang   = (Vector3){-radial.z, 0.0f, radial.x};
-
-    float f = Falloff(r, coreR, outerR);
-
-    // Core shaping so r->0 doesn't explode
-    float coreShape = r / (r + coreR);
-
-    // Slight altitude shaping (fits your y in [-50,50])
-    float y = q.y;
-    float inflowY = Clamp(1.0f - (y + 10.0f) / 80.0f, 0.25f, 1.0f);
-    float upY     = Clamp(0.7f + (y + 10.0f) / 120.0f, 0.5f, 1.4f);
-
-    Vector3 swirl   = Vector3Scale(tang,   swirlS   * f * (0.6f + 1.0f*coreShape));
-    Vector3 inflow  = Vector3Scale(radial, -inflowS * f * inflowY);
-    Vector3 updraft = Vector3Scale((Vector3){0,1,0}, updraftS * f * upY);
-
-    // Background storm shear (wind changes with height)
-    Vector3 shear = { shearS * (0.2f + 0.01f * y), 0.0f, 0.35f * shearS };
-
-    // Turbulence (small perturbation)
-    float tx = noise::fbm3(p.x*ns + 13.1f, p.y*ns + 7.7f,  p.z*ns + t*nt, 5, 2.0f, 0.5f);
-    float ty = noise::fbm3(p.x*ns + 21.4f, p.y*ns + 19.2f, p.z*ns + t*nt, 5, 2.0f, 0.5f);
-    float tz = noise::fbm3(p.x*ns + 5.6f,  p.y*ns + 31.8f, p.z*ns + t*nt, 5, 2.0f, 0.5f);
-
-    Vector3 turb = SafeNormalize((Vector3){tx, 0.25f*ty, tz});
-    turb = Vector3Scale(turb, turbS * f);
-
-    Vector3 wind = {0,0,0};
-    wind = Vector3Add(wind, swirl);
-    wind = Vector3Add(wind, inflow);
-    wind = Vector3Add(wind, updraft);
-    wind = Vector3Add(wind, shear);
-    wind = Vector3Add(wind, turb);
-    return wind;
+// A source and a sink under a steady breeze, with turbulence everywhere;
+// put together at run time
+static wind::DynamicField MakeSourceAndSink() {
+    wind::DynamicField f;
+    f.add(wind::Uniform{ { 1.5f, 0.0f, 0.5f } });
+
+    wind::PointSource source;
+    source.center = { -50.0f, -35.0f, 0.0f };
+    source.strength = 6.0f;
+    source.radius = 20.0f;
+    f.add(source);
+
+    wind::PointSource sink = source;
+    sink.center = { 50.0f, 35.0f, 0.0f };
+    sink.strength = -6.0f;
+    f.add(sink);
+
+    wind::Turbulence turb;
+    turb.outerR = 0.0f;
+    turb.strength = 0.8f;
+    f.add(turb);
+    return f;
 }
 
 static Vector3 RandInBox(BoundingBox b) {
@@ -107,30 +74,46 @@ int main() {
     box.max = {  100.0f,  50.0f,  100.0f };
 
     const int N = 6000;
-    std::vector<Particle3D> ps; ps.reserve(N);
+    const int TRAIL_LEN = 28;
+    ThreadPool pool;
+    ParticleSystem ps;
+    ps.pool = &pool;
+    ps.params.minSpeed = 0.3f;
+    ps.params.maxSpeed = 9.0f;
+    ps.params.drag     = 3.6f;
+    ps.init(N);
+    TrailArena trails;
+    trails.init(N, TRAIL_LEN);
+    FlowRenderer renderer;
+    renderer.load(N, TRAIL_LEN);
 
     for (int i = 0; i < N; ++i) {
-        Particle3D p;
-        p.pos = RandInBox(box);
-        p.vel = {0,0,0};
-
-        p.minSpeed = 0.3f;
-        p.maxSpeed = 9.0f;
-        p.drag     = 0.03f;
+        ps.set(i, RandInBox(box), {0,0,0});
+        trails.reset(i, ps.position(i));
+    }
 
-        p.trailEnabled = true;
-        p.trailLen = 28;
-        p.resetTrail();
+    // Wind baked on a 65x33x65 grid (about 3 units apart), keyframes 1 s apart
+    WindGrid grid;
+    grid.init(box, 65, 33, 65, 1.0f);
+    bool useGrid = true;
+    float gridError = 0.0f, gridMaxError = 0.0f;
+    int frame = 0;
 
-        ps.push_back(std::move(p));
-    }
+    Tornado tornado = MakeTornado();
+    wind::DynamicField sourceAndSink = MakeSourceAndSink();
+    bool tornadoScene = true;
 
     bool drawTrails = true;
     BoundsMode mode = BoundsMode::Wrap;
     float simTime = 0.0f;
+    uint64_t lastSamples = 0;
+
+    static const char* INTEGRATOR_NAMES[] = { "Euler", "RK2", "RK4", "RK45" };
 
     while (!WindowShouldClose()) {
-        float dt = std::min(GetFrameTime(), 1.0f/30.0f);
+        // Runge-Kutta stays accurate over long frames; Euler does not
+        const float maxDt = (ps.params.integrator == Integrator::Euler) ? 1.0f/30.0f : 0.1f;
+        float dt = std::min(GetFrameTime(), maxDt);
         simTime += dt;
 
         UpdateCamera(&cam, CAMERA_FREE);
@@ -138,8 +121,37 @@ int main() {
         if (IsKeyPressed(KEY_ONE)) mode = BoundsMode::Wrap;
         if (IsKeyPressed(KEY_TWO)) mode = BoundsMode::Bounce;
         if (IsKeyPressed(KEY_THREE)) mode = BoundsMode::Respawn;
+        if (IsKeyPressed(KEY_G)) useGrid = !useGrid;
+        if (IsKeyPressed(KEY_C)) renderer.cull = !renderer.cull;
+        if (IsKeyPressed(KEY_I)) ps.params.integrator = (Integrator)(((int)ps.params.integrator + 1) % 4);
+        if (IsKeyPressed(KEY_F)) {
+            tornadoScene = !tornadoScene;
+            grid.invalidate();
+        }
 
-        for (auto& p : ps) p.step(SampleWind, simTime, dt, box, mode);
+        // Live tuning; the baked grid catches up within two keyframes
+        wind::Vortex& vortex = tornado.part<wind::Vortex>();
+        wind::Turbulence& turb = tornado.part<wind::Turbulence>();
+        if (IsKeyPressed(KEY_RIGHT_BRACKET)) vortex.swirl += 1.0f;
+        if (IsKeyPressed(KEY_LEFT_BRACKET)) vortex.swirl = std::max(vortex.swirl - 1.0f, 0.0f);
+        if (IsKeyPressed(KEY_EQUAL)) turb.strength += 0.05f;
+        if (IsKeyPressed(KEY_MINUS)) turb.strength = std::max(turb.strength - 0.05f, 0.0f);
+
+        auto stepThrough = [&](const auto& field) {
+            if (useGrid) {
+                grid.update(field, simTime, &pool);
+                ps.step(grid, simTime, dt, box, mode);
+                // Check the baked field against the exact wind now and then
+                if (frame++ % 120 == 0) gridError = grid.error(field, 1024, &gridMaxError);
+            } else {
+                ps.step(field, simTime, dt, box, mode);
+            }
+        };
+        if (tornadoScene) stepThrough(tornado);
+        else stepThrough(sourceAndSink);
+        for (int i = 0; i < N; ++i) trails.push(i, ps.position(i));
+        const float samplesPerParticle = (float)(ps.windSamples() - lastSamples) / N;
+        lastSamples = ps.windSamples();
 
         BeginDrawing();
         ClearBackground(BLACK);
@@ -148,16 +160,31 @@ int main() {
         DrawBoundingBox(box, DARKGRAY);
         DrawGrid(0, 0.0f);
 
-        for (const auto& p : ps) {
-            if (drawTrails) p.drawTrail();
-            else p.draw(0.06f);
-        }
+        if (drawTrails) renderer.drawTrails(trails, cam, RAYWHITE);
+        else renderer.drawPoints(ps, cam, 0.06f, RAYWHITE);
         EndMode3D();
 
-        DrawText("T: trails   1:wrap 2:bounce 3:respawn", 10, 10, 18, RAYWHITE);
+        DrawText("T: trails   1:wrap 2:bounce 3:respawn   G: baked wind   F: scene   [ ]: swirl   - =: turbulence   I: integrator   C: culling",
+                 10, 10, 18, RAYWHITE);
+        if (tornadoScene)
+            DrawText(TextFormat("tornado: swirl %.0f, turbulence %.2f", vortex.swirl, turb.strength), 10, 58, 18, GRAY);
+        else
+            DrawText("source and sink", 10, 58, 18, GRAY);
+        if (useGrid)
+            DrawText(TextFormat("baked wind: rms error %.1f%%, max %.2f", gridError * 100.0f, gridMaxError),
+                     10, 34, 18, GRAY);
+        else
+            DrawText("exact wind", 10, 34, 18, GRAY);
+        DrawText(TextFormat("%s: %.1f wind samples per particle", INTEGRATOR_NAMES[(int)ps.params.integrator],
+                            samplesPerParticle), 10, 82, 18, GRAY);
+        const RenderStats& rs = renderer.stats();
+        DrawText(TextFormat("%s: %d / %d particles in view (%d / %d cells), %d vertices",
+                            renderer.cull ? "culling on" : "culling off", rs.visibleParticles, rs.particles,
+                            rs.visibleCells, rs.cells, rs.vertices), 10, 106, 18, GRAY);
         EndDrawing();
     }
 
+    renderer.unload();
     CloseWindow();
     return 0;
 }
@@ -1,131 +1,480 @@
 #include "particle.hpp"
+#include "thread_pool.hpp"
 #include <raymath.h>
 #include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
 
-// ---- helpers ----
-static inline Vector3 ClampSpeed(Vector3 v, float minSpeed, float maxSpeed) {
-    float m = Vector3Length(v);
-    if (m <= 1e-8f) return v;
-
-    if (m > maxSpeed) return Vector3Scale(v, maxSpeed / m);
-    if (m < minSpeed) return Vector3Scale(v, minSpeed / m);
-    return v;
-}
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
-static inline bool InBox(const Vector3& p, const BoundingBox& b) {
-    return (p.x >= b.min.x && p.x <= b.max.x &&
-            p.y >= b.min.y && p.y <= b.max.y &&
-            p.z >= b.min.z && p.z <= b.max.z);
+// ---- helpers ----
+// splitmix64: a counter goes in, a well mixed 64-bit value comes out
+static inline uint64_t Mix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
 }
 
-static inline float Frand01() {
-    return (float)GetRandomValue(0, 1000000) / 1000000.0f;
+static inline float Frand01(uint64_t& state) {
+    state = Mix64(state);
+    return (float)(state >> 40) / 16777216.0f;   // 24 bits: [0, 1)
 }
 
-static inline Vector3 RandomPointInBox(const BoundingBox& b) {
+// Same point for the same (seed, step, particle) whichever thread asks
+static inline Vector3 RandomPointInBox(const BoundingBox& b, uint64_t seed, uint64_t step, int i) {
+    uint64_t state = Mix64(seed ^ Mix64(step ^ Mix64((uint64_t)i)));
     return {
-        Lerp(b.min.x, b.max.x, Frand01()),
-        Lerp(b.min.y, b.max.y, Frand01()),
-        Lerp(b.min.z, b.max.z, Frand01())
+        Lerp(b.min.x, b.max.x, Frand01(state)),
+        Lerp(b.min.y, b.max.y, Frand01(state)),
+        Lerp(b.min.z, b.max.z, Frand01(state))
     };
 }
 
-static inline void WrapIntoBox(Vector3& p, const BoundingBox& b) {
-    const float sx = b.max.x - b.min.x;
-    const float sy = b.max.y - b.min.y;
-    const float sz = b.max.z - b.min.z;
+// Per-step constants of the batch kernels
+struct StepConsts {
+    float accel;        // dt / mass: force to velocity change
+    float damp;         // exp(-drag * dt): velocity kept over the step
+    float minSpeed, maxSpeed;
+    float dt;
+    BoundingBox box;
+    BoundsMode mode;
+};
 
-    if (p.x < b.min.x) p.x += sx;
-    if (p.x > b.max.x) p.x -= sx;
+// One batch of particles, in place. Returns a bit per lane that left the
+// box; only Respawn leaves those lanes outside for the caller to fix up.
+#if defined(__AVX2__)
 
-    if (p.y < b.min.y) p.y += sy;
-    if (p.y > b.max.y) p.y -= sy;
+// Per axis: wrap adds or subtracts the box size, bounce clamps onto the
+// face and flips the velocity sign
+static inline void WrapAxis(__m256& p, float lo, float hi) {
+    const __m256 vlo = _mm256_set1_ps(lo), vhi = _mm256_set1_ps(hi);
+    const __m256 size = _mm256_set1_ps(hi - lo);
+    p = _mm256_add_ps(p, _mm256_and_ps(_mm256_cmp_ps(p, vlo, _CMP_LT_OQ), size));
+    p = _mm256_sub_ps(p, _mm256_and_ps(_mm256_cmp_ps(p, vhi, _CMP_GT_OQ), size));
+}
 
-    if (p.z < b.min.z) p.z += sz;
-    if (p.z > b.max.z) p.z -= sz;
+static inline void BounceAxis(__m256& p, __m256& v, float lo, float hi) {
+    const __m256 vlo = _mm256_set1_ps(lo), vhi = _mm256_set1_ps(hi);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 below = _mm256_cmp_ps(p, vlo, _CMP_LT_OQ);
+    p = _mm256_blendv_ps(p, vlo, below);
+    v = _mm256_xor_ps(v, _mm256_and_ps(below, sign));
+    __m256 above = _mm256_cmp_ps(p, vhi, _CMP_GT_OQ);
+    p = _mm256_blendv_ps(p, vhi, above);
+    v = _mm256_xor_ps(v, _mm256_and_ps(above, sign));
 }
 
-static inline void BounceOnBox(Vector3& p, Vector3& v, const BoundingBox& b) {
-    if (p.x < b.min.x) { p.x = b.min.x; v.x = -v.x; }
-    if (p.x > b.max.x) { p.x = b.max.x; v.x = -v.x; }
+static inline __m256 Outside(__m256 p, float lo, float hi) {
+    return _mm256_or_ps(_mm256_cmp_ps(p, _mm256_set1_ps(lo), _CMP_LT_OQ),
+                        _mm256_cmp_ps(p, _mm256_set1_ps(hi), _CMP_GT_OQ));
+}
 
-    if (p.y < b.min.y) { p.y = b.min.y; v.y = -v.y; }
-    if (p.y > b.max.y) { p.y = b.max.y; v.y = -v.y; }
+static uint32_t StepBatch(float* px, float* py, float* pz,
+                          float* vx, float* vy, float* vz,
+                          const float* fx, const float* fy, const float* fz,
+                          const StepConsts& k) {
+    const __m256 accel = _mm256_set1_ps(k.accel);
+    const __m256 damp  = _mm256_set1_ps(k.damp);
+    const __m256 dt    = _mm256_set1_ps(k.dt);
+    const __m256 one   = _mm256_set1_ps(1.0f);
 
-    if (p.z < b.min.z) { p.z = b.min.z; v.z = -v.z; }
-    if (p.z > b.max.z) { p.z = b.max.z; v.z = -v.z; }
-}
+    // Integrate force, then drag
+    __m256 x = _mm256_loadu_ps(vx), y = _mm256_loadu_ps(vy), z = _mm256_loadu_ps(vz);
+    x = _mm256_mul_ps(_mm256_add_ps(x, _mm256_mul_ps(_mm256_loadu_ps(fx), accel)), damp);
+    y = _mm256_mul_ps(_mm256_add_ps(y, _mm256_mul_ps(_mm256_loadu_ps(fy), accel)), damp);
+    z = _mm256_mul_ps(_mm256_add_ps(z, _mm256_mul_ps(_mm256_loadu_ps(fz), accel)), damp);
 
-// ---- Particle3D ----
-Particle3D::Particle3D(Vector3 p, Vector3 v) : pos(p), vel(v) {
-    resetTrail();
-}
+    // Clamp speed: scale by max/m above the limit, min/m below it; still
+    // particles stay still
+    __m256 m = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)),
+                                            _mm256_mul_ps(z, z)));
+    __m256 fast = _mm256_cmp_ps(m, _mm256_set1_ps(k.maxSpeed), _CMP_GT_OQ);
+    __m256 slow = _mm256_and_ps(_mm256_cmp_ps(m, _mm256_set1_ps(k.minSpeed), _CMP_LT_OQ),
+                                _mm256_cmp_ps(m, _mm256_set1_ps(1e-8f), _CMP_GT_OQ));
+    slow = _mm256_andnot_ps(fast, slow);
+    __m256 limit = _mm256_blendv_ps(_mm256_set1_ps(k.minSpeed), _mm256_set1_ps(k.maxSpeed), fast);
+    __m256 scale = _mm256_blendv_ps(one, _mm256_div_ps(limit, m), _mm256_or_ps(fast, slow));
+    x = _mm256_mul_ps(x, scale);
+    y = _mm256_mul_ps(y, scale);
+    z = _mm256_mul_ps(z, scale);
 
-void Particle3D::resetTrail() {
-    trail.clear();
-    if (!trailEnabled || trailLen <= 0) return;
-    trail.reserve((size_t)trailLen);
-    for (int i = 0; i < trailLen; ++i) trail.push_back(pos);
-}
+    // Integrate velocity
+    __m256 p = _mm256_add_ps(_mm256_loadu_ps(px), _mm256_mul_ps(x, dt));
+    __m256 q = _mm256_add_ps(_mm256_loadu_ps(py), _mm256_mul_ps(y, dt));
+    __m256 r = _mm256_add_ps(_mm256_loadu_ps(pz), _mm256_mul_ps(z, dt));
+
+    // Handle bounds
+    const BoundingBox& b = k.box;
+    uint32_t out = 0;
+    switch (k.mode) {
+        case BoundsMode::Wrap:
+            WrapAxis(p, b.min.x, b.max.x);
+            WrapAxis(q, b.min.y, b.max.y);
+            WrapAxis(r, b.min.z, b.max.z);
+            break;
+        case BoundsMode::Bounce:
+            BounceAxis(p, x, b.min.x, b.max.x);
+            BounceAxis(q, y, b.min.y, b.max.y);
+            BounceAxis(r, z, b.min.z, b.max.z);
+            break;
+        case BoundsMode::Respawn:
+            out = (uint32_t)_mm256_movemask_ps(_mm256_or_ps(
+                _mm256_or_ps(Outside(p, b.min.x, b.max.x), Outside(q, b.min.y, b.max.y)),
+                Outside(r, b.min.z, b.max.z)));
+            break;
+    }
 
-void Particle3D::applyForce(Vector3 f) {
-    // F = m a  =>  a += F/m
-    if (mass <= 1e-8f) return;
-    acc = Vector3Add(acc, Vector3Scale(f, 1.0f / mass));
+    _mm256_storeu_ps(px, p); _mm256_storeu_ps(py, q); _mm256_storeu_ps(pz, r);
+    _mm256_storeu_ps(vx, x); _mm256_storeu_ps(vy, y); _mm256_storeu_ps(vz, z);
+    return out;
 }
 
+#else
 
-void Particle3D::step(WindFn windFn, float t, float dt, BoundingBox box, BoundsMode mode) {
-    // Apply wind force
-    Vector3 wind = windFn(pos, t);
-    applyForce(wind);
+static inline void WrapAxis(float& p, float lo, float hi) {
+    if (p < lo) p += hi - lo;
+    if (p > hi) p -= hi - lo;
+}
 
-    // Integrate acceleration
-    vel = Vector3Add(vel, Vector3Scale(acc, dt));
-    acc = {0,0,0}; // reset acceleration
+static inline void BounceAxis(float& p, float& v, float lo, float hi) {
+    if (p < lo) { p = lo; v = -v; }
+    if (p > hi) { p = hi; v = -v; }
+}
 
-    // Apply drag
-    vel = Vector3Scale(vel, 1.0f - drag);
+static uint32_t StepBatch(float* px, float* py, float* pz,
+                          float* vx, float* vy, float* vz,
+                          const float* fx, const float* fy, const float* fz,
+                          const StepConsts& k) {
+    const BoundingBox& b = k.box;
+    uint32_t out = 0;
+    for (int j = 0; j < ParticleSystem::BATCH; ++j) {
+        // Integrate force, then drag
+        float x = (vx[j] + fx[j] * k.accel) * k.damp;
+        float y = (vy[j] + fy[j] * k.accel) * k.damp;
+        float z = (vz[j] + fz[j] * k.accel) * k.damp;
 
-    // Clamp speed
-    vel = ClampSpeed(vel, minSpeed, maxSpeed);
+        // Clamp speed
+        float m = sqrtf(x*x + y*y + z*z);
+        if (m > 1e-8f) {
+            if (m > k.maxSpeed)      { float s = k.maxSpeed / m; x *= s; y *= s; z *= s; }
+            else if (m < k.minSpeed) { float s = k.minSpeed / m; x *= s; y *= s; z *= s; }
+        }
 
-    // Integrate velocity
-    pos = Vector3Add(pos, Vector3Scale(vel, dt));
+        // Integrate velocity
+        float p = px[j] + x * k.dt;
+        float q = py[j] + y * k.dt;
+        float r = pz[j] + z * k.dt;
 
-    // Handle bounds
-    bool inBox = InBox(pos, box);
-    if (!inBox) {
-        switch (mode) {
+        // Handle bounds
+        switch (k.mode) {
             case BoundsMode::Wrap:
-                WrapIntoBox(pos, box);
+                WrapAxis(p, b.min.x, b.max.x);
+                WrapAxis(q, b.min.y, b.max.y);
+                WrapAxis(r, b.min.z, b.max.z);
                 break;
             case BoundsMode::Bounce:
-                BounceOnBox(pos, vel, box);
+                BounceAxis(p, x, b.min.x, b.max.x);
+                BounceAxis(q, y, b.min.y, b.max.y);
+                BounceAxis(r, z, b.min.z, b.max.z);
                 break;
             case BoundsMode::Respawn:
-                pos = RandomPointInBox(box);
-                vel = {0,0,0};
+                if (p < b.min.x || p > b.max.x || q < b.min.y || q > b.max.y ||
+                    r < b.min.z || r > b.max.z) out |= 1u << j;
                 break;
         }
+
+        px[j] = p; py[j] = q; pz[j] = r;
+        vx[j] = x; vy[j] = y; vz[j] = z;
     }
+    return out;
+}
+
+#endif
+
+// ---- ParticleSystem ----
+void ParticleSystem::init(int count) {
+    n = std::max(count, 0);
+    const size_t padded = (size_t)(n + BATCH - 1) / BATCH * BATCH;
+    for (FloatArray* a : { &px, &py, &pz, &vx, &vy, &vz, &fx, &fy, &fz, &hs })
+        a->assign(padded, 0.0f);
+}
+
+void ParticleSystem::set(int i, Vector3 p, Vector3 v) {
+    px[i] = p.x; py[i] = p.y; pz[i] = p.z;
+    vx[i] = v.x; vy[i] = v.y; vz[i] = v.z;
+    hs[i] = 0.0f;
+}
+
+// ---- Runge-Kutta ----
+// Explicit Runge-Kutta method: stage i is evaluated at
+// s + h * sum(a[i][j] * k[j]), the step ends at s + h * sum(b[j] * k[j]),
+// and h * sum(e[j] * k[j]) estimates its error (e all zero: no estimate).
+// With fsal the last stage is taken at the end of the step, so it is the
+// first stage of the next one.
+struct Tableau {
+    int stages;
+    bool fsal;
+    float a[7][7];
+    float b[7];
+    float e[7];
+};
+
+static const Tableau RK2_MIDPOINT = {
+    2, false,
+    { {}, { 0.5f } },
+    { 0.0f, 1.0f },
+    {}
+};
+
+static const Tableau RK4_CLASSIC = {
+    4, false,
+    { {}, { 0.5f }, { 0.0f, 0.5f }, { 0.0f, 0.0f, 1.0f } },
+    { 1.0f / 6.0f, 1.0f / 3.0f, 1.0f / 3.0f, 1.0f / 6.0f },
+    {}
+};
 
-    // Update trail
-    if (trailEnabled && trailLen > 0) {
-        trail.push_back(pos);
-        if (trail.size() > (size_t)trailLen) {
-            trail.erase(trail.begin());
+static const Tableau DORMAND_PRINCE = {
+    7, true,
+    {
+        {},
+        { 1.0f / 5.0f },
+        { 3.0f / 40.0f, 9.0f / 40.0f },
+        { 44.0f / 45.0f, -56.0f / 15.0f, 32.0f / 9.0f },
+        { 19372.0f / 6561.0f, -25360.0f / 2187.0f, 64448.0f / 6561.0f, -212.0f / 729.0f },
+        { 9017.0f / 3168.0f, -355.0f / 33.0f, 46732.0f / 5247.0f, 49.0f / 176.0f, -5103.0f / 18656.0f },
+        { 35.0f / 384.0f, 0.0f, 500.0f / 1113.0f, 125.0f / 192.0f, -2187.0f / 6784.0f, 11.0f / 84.0f }
+    },
+    { 35.0f / 384.0f, 0.0f, 500.0f / 1113.0f, 125.0f / 192.0f, -2187.0f / 6784.0f, 11.0f / 84.0f, 0.0f },
+    { 71.0f / 57600.0f, 0.0f, -71.0f / 16695.0f, 71.0f / 1920.0f, -17253.0f / 339200.0f, 22.0f / 525.0f, -1.0f / 40.0f }
+};
+
+// Sub-step limits of RK45, as fractions of the frame step. A particle
+// still stepping in the last round takes the rest of the frame in one
+// step, whatever its error, so no particle falls behind the clock.
+static const float MIN_STEP = 1.0f / 64.0f;
+static const int MAX_ROUNDS = 64;
+
+// Working arrays of one chunk. State and derivatives are six arrays each:
+// x, y, z, vx, vy, vz.
+struct RkScratch {
+    std::vector<float> s[6];        // per chunk particle: state
+    std::vector<float> k1[6];       // per chunk particle: first stage
+    std::vector<float> h, left;     // per chunk particle: step size, time left
+    std::vector<int> active;        // chunk particles still stepping
+    std::vector<float> y[6];        // per active slot: stage state
+    std::vector<float> k[7][6];     // per active slot: stage derivatives
+    std::vector<float> hh;          // per active slot: step size
+
+    void resize(int m) {
+        for (int c = 0; c < 6; ++c) {
+            s[c].resize(m); k1[c].resize(m); y[c].resize(m);
+            for (int i = 0; i < 7; ++i) k[i][c].resize(m);
         }
+        h.resize(m); left.resize(m); active.resize(m); hh.resize(m);
     }
-}
+};
 
-void Particle3D::draw(float radius) const {
-    DrawSphere(pos, radius, RAYWHITE);
+static thread_local RkScratch scratch;
+
+// What the Runge-Kutta steps integrate, from the particle parameters
+struct Dynamics {
+    float invMass, drag;
+    float minSpeed, maxSpeed;
+    float minSpeed2, maxSpeed2;
+};
+
+// How fast, per second, a speed outside [minSpeed, maxSpeed] is pulled
+// back in. Low enough that RK2 stays stable at a 0.1 s step.
+static const float LIMIT_RATE = 10.0f;
+
+// Derivative at state y for count slots: position' = velocity,
+// velocity' = wind / m - drag * velocity. The speed limits are part of
+// the motion rather than a clamp after the step, which would make the
+// path depend on the step length: past maxSpeed the velocity decays
+// towards it, below minSpeed it grows, the push fading out towards rest
+// so the derivative stays continuous.
+static void Derivative(const wind::SampleFn& wind, float t, const Dynamics& d,
+                       std::vector<float>* y, std::vector<float>* k, int count) {
+    wind(y[0].data(), y[1].data(), y[2].data(), count, t, k[3].data(), k[4].data(), k[5].data());
+    for (int c = 0; c < 3; ++c) {
+        const float* v = y[3 + c].data();
+        float* dv = k[3 + c].data();
+        std::copy(v, v + count, k[c].data());
+        for (int i = 0; i < count; ++i) dv[i] = dv[i] * d.invMass - d.drag * v[i];
+    }
+
+    const float *vx = y[3].data(), *vy = y[4].data(), *vz = y[5].data();
+    float *ax = k[3].data(), *ay = k[4].data(), *az = k[5].data();
+    for (int i = 0; i < count; ++i) {
+        const float s2 = vx[i] * vx[i] + vy[i] * vy[i] + vz[i] * vz[i];
+        if (s2 <= d.maxSpeed2 && s2 >= d.minSpeed2) continue;
+        const float speed = sqrtf(s2);
+        const float f = (s2 > d.maxSpeed2) ? LIMIT_RATE * (d.maxSpeed - speed) / speed
+                                           : LIMIT_RATE * (1.0f - speed / d.minSpeed);
+        ax[i] += f * vx[i];
+        ay[i] += f * vy[i];
+        az[i] += f * vz[i];
+    }
 }
 
-void Particle3D::drawTrail() const {
-    if (!trailEnabled || trail.size() < 2) return;
-    for (size_t i = 1; i < trail.size(); ++i) {
-        DrawLine3D(trail[i - 1], trail[i], RAYWHITE);
+void ParticleSystem::rungeKutta(const wind::SampleFn& wind, float t, float dt, int begin, int end) {
+    const Tableau& T = (params.integrator == Integrator::RK2) ? RK2_MIDPOINT :
+                       (params.integrator == Integrator::RK4) ? RK4_CLASSIC : DORMAND_PRINCE;
+    const bool adaptive = params.integrator == Integrator::RK45;
+    const Dynamics dyn = { params.mass > 1e-8f ? 1.0f / params.mass : 0.0f, params.drag,
+                           params.minSpeed, params.maxSpeed,
+                           params.minSpeed * params.minSpeed, params.maxSpeed * params.maxSpeed };
+    const float tol = std::max(params.tolerance, 1e-6f);
+    const float hMin = dt * MIN_STEP;
+
+    const int m = end - begin;
+    RkScratch& w = scratch;
+    w.resize(m);
+    float* const state[6] = { &px[begin], &py[begin], &pz[begin], &vx[begin], &vy[begin], &vz[begin] };
+    for (int c = 0; c < 6; ++c) std::copy(state[c], state[c] + m, w.s[c].begin());
+    for (int i = 0; i < m; ++i) {
+        w.left[i] = dt;
+        w.h[i] = (adaptive && hs[begin + i] > 0.0f) ? std::min(hs[begin + i], dt) : dt;
+        w.active[i] = i;
+    }
+
+    // First stage of every particle; with fsal later ones come for free
+    for (int c = 0; c < 6; ++c) std::copy(w.s[c].begin(), w.s[c].begin() + m, w.y[c].begin());
+    Derivative(wind, t, dyn, w.y, w.k1, m);
+    uint64_t taken = (uint64_t)m;
+
+    int count = m;
+    for (int round = 0; count > 0 && round < MAX_ROUNDS; ++round) {
+        // Gather the particles still stepping
+        for (int a = 0; a < count; ++a) {
+            const int i = w.active[a];
+            for (int c = 0; c < 6; ++c) w.k[0][c][a] = w.k1[c][i];
+            w.hh[a] = w.h[i];
+        }
+
+        // Remaining stages
+        for (int st = 1; st < T.stages; ++st) {
+            for (int c = 0; c < 6; ++c) {
+                float* yc = w.y[c].data();
+                for (int a = 0; a < count; ++a) {
+                    float sum = 0.0f;
+                    for (int j = 0; j < st; ++j) sum += T.a[st][j] * w.k[j][c][a];
+                    yc[a] = w.s[c][w.active[a]] + w.hh[a] * sum;
+                }
+            }
+            Derivative(wind, t, dyn, w.y, w.k[st], count);
+            taken += (uint64_t)count;
+        }
+
+        // Accept or retry each particle, and pick its next step size
+        int still = 0;
+        for (int a = 0; a < count; ++a) {
+            const int i = w.active[a];
+            const float h = w.hh[a];
+
+            float ratio = 0.0f;
+            if (adaptive) {
+                float e[6];
+                for (int c = 0; c < 6; ++c) {
+                    float sum = 0.0f;
+                    for (int j = 0; j < T.stages; ++j) sum += T.e[j] * w.k[j][c][a];
+                    e[c] = h * sum;
+                }
+                // Velocity error counts by how far it moves the particle in h
+                float ePos = sqrtf(e[0]*e[0] + e[1]*e[1] + e[2]*e[2]);
+                float eVel = sqrtf(e[3]*e[3] + e[4]*e[4] + e[5]*e[5]) * h;
+                ratio = std::max(ePos, eVel) / tol;
+            }
+
+            const bool last = round == MAX_ROUNDS - 1;
+            const bool accept = ratio <= 1.0f || h <= hMin * 1.001f || last;
+            if (accept) {
+                for (int c = 0; c < 6; ++c) {
+                    float sum = 0.0f;
+                    for (int j = 0; j < T.stages; ++j) sum += T.b[j] * w.k[j][c][a];
+                    w.s[c][i] += h * sum;
+                    if (T.fsal) w.k1[c][i] = w.k[T.stages - 1][c][a];
+                }
+                w.left[i] -= h;
+            }
+
+            // Standard controller for a 5th order step: grow up to 5x,
+            // shrink down to 1/5
+            float next = h;
+            if (adaptive) {
+                float grow = (ratio > 0.0f) ? 0.9f * powf(ratio, -0.2f) : 5.0f;
+                next = std::max(h * std::min(std::max(grow, 0.2f), 5.0f), hMin);
+                hs[begin + i] = next;
+            }
+
+            if (w.left[i] > dt * 1e-5f && !last) {
+                w.h[i] = (round + 2 == MAX_ROUNDS) ? w.left[i] : std::min(next, w.left[i]);
+                w.active[still++] = i;
+            }
+        }
+        count = still;
     }
+
+    for (int c = 0; c < 6; ++c) std::copy(w.s[c].begin(), w.s[c].begin() + m, state[c]);
+    samples.fetch_add(taken, std::memory_order_relaxed);
+}
+
+// n / (4 threads) rounded up to whole cache lines; one MAX_CHUNK task
+// after another without a pool
+int ParticleSystem::chunkSize() const {
+    const int tasks = pool ? 4 * pool->size() : 1;
+    const int chunk = ((n + tasks - 1) / tasks + 15) & ~15;
+    return std::min(std::max(chunk, 16), MAX_CHUNK);
+}
+
+void ParticleSystem::integrate(const wind::SampleFn& wind, float t, float dt, BoundingBox box, BoundsMode mode) {
+    const bool euler = params.integrator == Integrator::Euler;
+
+    // Euler: F = m a, so the force changes the velocity by F/m dt (a
+    // massless particle ignores it), then drag decays it by exp(-drag dt)
+    // and the speed is clamped. Runge-Kutta has already moved the
+    // particles, speed limits included; the same kernel with no force, no
+    // time step and no limits then only applies bounds.
+    StepConsts k;
+    k.accel = (euler && params.mass > 1e-8f) ? dt / params.mass : 0.0f;
+    k.damp = euler ? expf(-params.drag * dt) : 1.0f;
+    k.minSpeed = euler ? params.minSpeed : 0.0f;
+    k.maxSpeed = euler ? params.maxSpeed : FLT_MAX;
+    k.dt = euler ? dt : 0.0f;
+    k.box = box;
+    k.mode = mode;
+
+    const int padded = (int)px.size();
+    const uint64_t step = steps++;
+    const int chunk = chunkSize();
+    auto stepChunk = [&](int c) {
+        const int begin = c * chunk;
+        const int end = std::min(begin + chunk, padded);
+
+        if (begin < n) {
+            const int last = std::min(end, n);
+            if (euler) {
+                wind(&px[begin], &py[begin], &pz[begin], last - begin, t, &fx[begin], &fy[begin], &fz[begin]);
+                samples.fetch_add((uint64_t)(last - begin), std::memory_order_relaxed);
+            } else {
+                rungeKutta(wind, t, dt, begin, last);
+            }
+        }
+
+        for (int i = begin; i < end; i += BATCH) {
+            uint32_t out = StepBatch(&px[i], &py[i], &pz[i], &vx[i], &vy[i], &vz[i],
+                                     &fx[i], &fy[i], &fz[i], k);
+            for (int j = 0; out; ++j, out >>= 1) {
+                if ((out & 1) && i + j < n) set(i + j, RandomPointInBox(box, seed, step, i + j), {0,0,0});
+            }
+        }
+    };
+
+    const int chunks = (padded + chunk - 1) / chunk;
+    if (pool) pool->parallelFor(chunks, stepChunk);
+    else for (int c = 0; c < chunks; ++c) stepChunk(c);
 }
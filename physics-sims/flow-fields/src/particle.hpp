@@ -1,10 +1,15 @@
 #pragma once
 #include <raylib.h>
 #include <raymath.h>
-#include <algorithm>
+#include <cstddef>
+#include <atomic>
+#include <cstdint>
+#include <new>
 #include <vector>
+#include <functional>
+#include "field.hpp"
 
-using WindFn = Vector3 (*)(Vector3, float);
+class ThreadPool;
 
 
 enum class BoundsMode {
@@ -13,33 +18,115 @@ enum class BoundsMode {
     Respawn
 };
 
-struct Particle3D {
-    Vector3 pos{0,0,0};
-    Vector3 vel{0,0,0};
-    Vector3 acc{0,0,0};
+// How a step moves particles through the wind:
+//   Euler  one wind sample per particle, force then velocity (SIMD kernel)
+//   RK2    midpoint method, 2 samples
+//   RK4    classic Runge-Kutta, 4 samples
+//   RK45   Dormand-Prince 5(4) with per-particle error control: each
+//          particle sub-steps as finely as its path needs and keeps its
+//          step size for the next frame; 7 samples for the first sub-step,
+//          6 for each one after it
+enum class Integrator {
+    Euler,
+    RK2,
+    RK4,
+    RK45
+};
 
+// Settings shared by every particle of a system
+struct ParticleParams {
     float minSpeed = 0.0f;
     float maxSpeed = 6.0f;
-    float drag     = 0.05f;   // 0..1 (higher = more damping)
+    float drag     = 3.6f;    // 1/s: without wind, speed decays as exp(-drag t)
     float mass     = 1.0f;
+    Integrator integrator = Integrator::Euler;
+    float tolerance = 0.01f;  // RK45: position error allowed per sub-step (world units)
+};
+
+// Allocator for the particle arrays: storage starts on a cache line, so
+// chunks that start on a multiple of 16 floats never share a line
+template <typename T>
+struct CacheAligned {
+    using value_type = T;
+    static const size_t ALIGN = 64;
 
-    // Visuals (optional trail)
-    bool  trailEnabled = true;
-    int   trailLen     = 32;
-    std::vector<Vector3> trail;
+    CacheAligned() = default;
+    template <typename U> CacheAligned(const CacheAligned<U>&) {}
 
-    Particle3D() = default;
-    Particle3D(Vector3 p, Vector3 v);
+    T* allocate(size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(ALIGN)));
+    }
+    void deallocate(T* p, size_t) { ::operator delete(p, std::align_val_t(ALIGN)); }
 
-    void resetTrail();
-    void applyForce(Vector3 f);
+    template <typename U> bool operator==(const CacheAligned<U>&) const { return true; }
+    template <typename U> bool operator!=(const CacheAligned<U>&) const { return false; }
+};
 
+using FloatArray = std::vector<float, CacheAligned<float>>;
 
-void step(WindFn windFn, float t, float dt, BoundingBox box,
-          BoundsMode mode = BoundsMode::Wrap);
+// Particles as a structure of arrays: positions and velocities are kept one
+// coordinate per array, so integration, drag, speed clamping and bounds run
+// over BATCH particles at a time (AVX2 when the compiler targets it, plain
+// scalar code otherwise; both do the same operations in the same order).
+//
+// The arrays are padded to a multiple of BATCH. Padding lanes are stepped
+// along with the rest but never get wind, respawn or trails.
+//
+// With a pool the step is split into about four tasks per thread, so a
+// thread that falls behind can be made up for, of at most MAX_CHUNK
+// particles. Chunk sizes are a multiple of 16, so each chunk covers whole
+// cache lines of every array and threads never write the same line.
+// Respawn positions come from a hash of (seed, step, particle), not from
+// shared generator state, so the result does not depend on the thread
+// count or on which thread got which chunk.
+//
+// The motion is x' = v, v' = F(x)/m - drag v. Within one step the wind is
+// held at the step's time t; it changes over seconds, not within a frame.
+// Runge-Kutta pulls the speed back inside the limits as part of the
+// motion; Euler clamps it after the step. Bounds apply once, after it.
+// Trails live in a TrailArena (trail.hpp), indexed like the particles.
+class ParticleSystem {
+public:
+    static const int BATCH = 8;
+    static const int MAX_CHUNK = 2048;             // particles per task at most, a multiple of 16
 
+    ParticleParams params;
+    ThreadPool* pool = nullptr;                    // steps chunks in parallel when set
+    uint64_t seed = 1;                             // respawn positions
 
-    void draw(float radius = 0.03f) const;         // particle as small sphere
-    void drawTrail() const;                        // line trail
-};
+    void init(int count);                          // count particles at the origin, at rest
+    int count() const { return n; }
+
+    void set(int i, Vector3 p, Vector3 v);
+    Vector3 position(int i) const { return { px[i], py[i], pz[i] }; }
+    Vector3 velocity(int i) const { return { vx[i], vy[i], vz[i] }; }
 
+    // The state arrays, count() values each
+    struct State { const float *px, *py, *pz, *vx, *vy, *vz; };
+    State state() const { return { px.data(), py.data(), pz.data(), vx.data(), vy.data(), vz.data() }; }
+
+    // Moves every particle through wind field `field` (field.hpp) at time t
+    // with params.integrator; the field is sampled in batches, one chunk or
+    // Runge-Kutta stage at a time
+    template <typename Field>
+    void step(const Field& field, float t, float dt, BoundingBox box,
+              BoundsMode mode = BoundsMode::Wrap) {
+        integrate(wind::sampler(field), t, dt, box, mode);
+    }
+
+    // Wind samples taken so far, one per particle per stage
+    uint64_t windSamples() const { return samples.load(std::memory_order_relaxed); }
+
+private:
+    int n = 0;
+    uint64_t steps = 0;
+    FloatArray px, py, pz;
+    FloatArray vx, vy, vz;
+    FloatArray fx, fy, fz;                         // wind force of the current step (Euler)
+    FloatArray hs;                                 // RK45 step size per particle, 0: not yet known
+    std::atomic<uint64_t> samples{0};
+
+    int chunkSize() const;
+    void integrate(const wind::SampleFn& wind, float t, float dt, BoundingBox box, BoundsMode mode);
+    void rungeKutta(const wind::SampleFn& wind, float t, float dt, int begin, int end);
+};
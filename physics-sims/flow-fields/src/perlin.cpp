@@ -6,15 +6,23 @@
 #include <random>
 #include <cmath>
 
-namespace noise {
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define NOISE_AVX2 1
+#endif
 
-static std::array<int, 512> p{};
-static bool initialized = false;
+namespace noise {
 
 static inline float fade(float t) {
     return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
 }
 
+// Derivative of fade: 30 t^2 (t - 1)^2
+static inline float dfade(float t) {
+    const float s = t * (t - 1.0f);
+    return 30.0f * s * s;
+}
+
 static inline float lerp(float a, float b, float t) {
     return a + t * (b - a);
 }
@@ -33,25 +41,59 @@ static inline float grad(int hash, float x, float y, float z) {
     return a + b;
 }
 
-static void initDefault() {
-    // Default permutation (0..255 shuffled) expanded to 512
+// The direction grad() dots with: grad(h, x, y, z) = g . (x, y, z)
+static inline void gradVector(int hash, float g[3]) {
+    g[0] = grad(hash, 1.0f, 0.0f, 0.0f);
+    g[1] = grad(hash, 0.0f, 1.0f, 0.0f);
+    g[2] = grad(hash, 0.0f, 0.0f, 1.0f);
+}
+
+// Trilinear blend of 8 corner values (order 000, 100, 010, 110, 001, 101,
+// 011, 111) in polynomial form; d gets the derivatives by u, v and w
+static inline float blend(const float c[8], float u, float v, float w, float d[3]) {
+    const float k1 = c[1] - c[0];
+    const float k2 = c[2] - c[0];
+    const float k3 = c[4] - c[0];
+    const float k4 = c[0] - c[1] - c[2] + c[3];
+    const float k5 = c[0] - c[2] - c[4] + c[6];
+    const float k6 = c[0] - c[1] - c[4] + c[5];
+    const float k7 = -c[0] + c[1] + c[2] - c[3] + c[4] - c[5] - c[6] + c[7];
+    if (d) {
+        d[0] = k1 + k4 * v + k6 * w + k7 * v * w;
+        d[1] = k2 + k4 * u + k5 * w + k7 * u * w;
+        d[2] = k3 + k5 * v + k6 * u + k7 * u * v;
+    }
+    return c[0] + k1 * u + k2 * v + k3 * w + k4 * u * v + k5 * v * w + k6 * w * u + k7 * u * v * w;
+}
+
+// Offsets of the three curl potentials, far enough apart to be unrelated
+static const float CURL_OFFSETS[3][3] = {
+    {    0.0f,     0.0f,    0.0f },
+    {   31.416f,  -47.853f,  12.793f },
+    { -233.145f, -113.408f, -185.31f }
+};
+
+// ---- Perlin ----
+Perlin::Perlin(uint32_t seed) {
+    setSeed(seed);
+}
+
+void Perlin::setSeed(uint32_t seed) {
+    // Permutation of 0..255 shuffled by the seed, expanded to 512
     std::array<int, 256> perm{};
     std::iota(perm.begin(), perm.end(), 0);
 
-    // Fixed seed by default so it’s deterministic without calling setSeed()
-    std::mt19937 rng(1337u);
+    std::mt19937 rng(seed);
     std::shuffle(perm.begin(), perm.end(), rng);
 
     for (int i = 0; i < 256; ++i) {
         p[i] = perm[i];
         p[i + 256] = perm[i];
     }
-    initialized = true;
+    seedValue = seed;
 }
 
-float perlin3(float x, float y, float z) {
-    if (!initialized) initDefault();
-
+float Perlin::perlin3(float x, float y, float z) const {
     // Find unit cube that contains the point
     const int X = static_cast<int>(std::floor(x)) & 255;
     const int Y = static_cast<int>(std::floor(y)) & 255;
@@ -105,7 +147,43 @@ float perlin3(float x, float y, float z) {
     return lerp(y1, y2, w); // roughly [-1, 1]
 }
 
-float fbm3(float x, float y, float z, int octaves, float lacunarity, float gain) {
+float Perlin::perlin3Grad(float x, float y, float z, float g[3]) const {
+    const int X = static_cast<int>(std::floor(x)) & 255;
+    const int Y = static_cast<int>(std::floor(y)) & 255;
+    const int Z = static_cast<int>(std::floor(z)) & 255;
+
+    const float xf = x - std::floor(x);
+    const float yf = y - std::floor(y);
+    const float zf = z - std::floor(z);
+
+    const int A  = p[X] + Y;
+    const int B  = p[X + 1] + Y;
+    const int hash[8] = {
+        p[p[A] + Z],     p[p[B] + Z],     p[p[A + 1] + Z],     p[p[B + 1] + Z],
+        p[p[A] + Z + 1], p[p[B] + Z + 1], p[p[A + 1] + Z + 1], p[p[B + 1] + Z + 1]
+    };
+
+    // Corner values, and the corner gradients by axis
+    float value[8], gx[8], gy[8], gz[8];
+    for (int c = 0; c < 8; ++c) {
+        float dir[3];
+        gradVector(hash[c], dir);
+        gx[c] = dir[0]; gy[c] = dir[1]; gz[c] = dir[2];
+        value[c] = grad(hash[c], xf - (c & 1), yf - ((c >> 1) & 1), zf - (c >> 2));
+    }
+
+    // The value blends the corners with fade weights; its gradient is the
+    // blended corner gradients plus the change of the weights themselves
+    const float u = fade(xf), v = fade(yf), w = fade(zf);
+    float d[3];
+    const float n = blend(value, u, v, w, d);
+    g[0] = blend(gx, u, v, w, nullptr) + dfade(xf) * d[0];
+    g[1] = blend(gy, u, v, w, nullptr) + dfade(yf) * d[1];
+    g[2] = blend(gz, u, v, w, nullptr) + dfade(zf) * d[2];
+    return n;
+}
+
+float Perlin::fbm3(float x, float y, float z, int octaves, float lacunarity, float gain) const {
     float sum = 0.0f;
     float amp = 1.0f;
     float freq = 1.0f;
@@ -123,4 +201,325 @@ float fbm3(float x, float y, float z, int octaves, float lacunarity, float gain)
     return (norm > 0.0f) ? (sum / norm) : 0.0f;
 }
 
+float Perlin::fbm3Grad(float x, float y, float z, float g[3], int octaves, float lacunarity, float gain) const {
+    float sum = 0.0f, gsum[3] = { 0.0f, 0.0f, 0.0f };
+    float amp = 1.0f;
+    float freq = 1.0f;
+    float norm = 0.0f;
+
+    // d/dx of perlin3(x * freq) is freq times its gradient
+    for (int i = 0; i < octaves; ++i) {
+        float o[3];
+        sum += amp * perlin3Grad(x * freq, y * freq, z * freq, o);
+        for (int k = 0; k < 3; ++k) gsum[k] += amp * freq * o[k];
+        norm += amp;
+        freq *= lacunarity;
+        amp *= gain;
+    }
+
+    const float inv = (norm > 0.0f) ? 1.0f / norm : 0.0f;
+    for (int k = 0; k < 3; ++k) g[k] = gsum[k] * inv;
+    return sum * inv;
+}
+
+void Perlin::curl3(float x, float y, float z, float out[3], int octaves, float lacunarity, float gain) const {
+    float d[3][3];
+    for (int k = 0; k < 3; ++k) {
+        fbm3Grad(x + CURL_OFFSETS[k][0], y + CURL_OFFSETS[k][1], z + CURL_OFFSETS[k][2], d[k],
+                 octaves, lacunarity, gain);
+    }
+    out[0] = d[2][1] - d[1][2];
+    out[1] = d[0][2] - d[2][0];
+    out[2] = d[1][0] - d[0][1];
+}
+
+// ---- batches ----
+#if defined(NOISE_AVX2)
+
+namespace {
+
+// Hashes and in-cube position of 8 points
+struct Cell8 {
+    __m256i hash[8];            // corners 000, 100, 010, 110, 001, 101, 011, 111
+    __m256 xf, yf, zf;
+};
+
+inline __m256i gather(const int32_t* p, __m256i i) {
+    return _mm256_i32gather_epi32(p, i, 4);
+}
+
+inline Cell8 locate(const int32_t* p, __m256 x, __m256 y, __m256 z) {
+    const __m256i mask = _mm256_set1_epi32(255), one = _mm256_set1_epi32(1);
+    const __m256 fx = _mm256_floor_ps(x), fy = _mm256_floor_ps(y), fz = _mm256_floor_ps(z);
+    const __m256i X = _mm256_and_si256(_mm256_cvttps_epi32(fx), mask);
+    const __m256i Y = _mm256_and_si256(_mm256_cvttps_epi32(fy), mask);
+    const __m256i Z = _mm256_and_si256(_mm256_cvttps_epi32(fz), mask);
+
+    const __m256i A  = _mm256_add_epi32(gather(p, X), Y);
+    const __m256i B  = _mm256_add_epi32(gather(p, _mm256_add_epi32(X, one)), Y);
+    const __m256i AA = _mm256_add_epi32(gather(p, A), Z);
+    const __m256i AB = _mm256_add_epi32(gather(p, _mm256_add_epi32(A, one)), Z);
+    const __m256i BA = _mm256_add_epi32(gather(p, B), Z);
+    const __m256i BB = _mm256_add_epi32(gather(p, _mm256_add_epi32(B, one)), Z);
+
+    Cell8 c;
+    c.hash[0] = gather(p, AA);
+    c.hash[1] = gather(p, BA);
+    c.hash[2] = gather(p, AB);
+    c.hash[3] = gather(p, BB);
+    c.hash[4] = gather(p, _mm256_add_epi32(AA, one));
+    c.hash[5] = gather(p, _mm256_add_epi32(BA, one));
+    c.hash[6] = gather(p, _mm256_add_epi32(AB, one));
+    c.hash[7] = gather(p, _mm256_add_epi32(BB, one));
+    c.xf = _mm256_sub_ps(x, fx);
+    c.yf = _mm256_sub_ps(y, fy);
+    c.zf = _mm256_sub_ps(z, fz);
+    return c;
+}
+
+inline __m256 fade8(__m256 t) {
+    __m256 s = _mm256_fmadd_ps(t, _mm256_set1_ps(6.0f), _mm256_set1_ps(-15.0f));
+    s = _mm256_fmadd_ps(t, s, _mm256_set1_ps(10.0f));
+    return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t), s);
+}
+
+inline __m256 dfade8(__m256 t) {
+    __m256 s = _mm256_mul_ps(t, _mm256_sub_ps(t, _mm256_set1_ps(1.0f)));
+    return _mm256_mul_ps(_mm256_set1_ps(30.0f), _mm256_mul_ps(s, s));
+}
+
+inline __m256 lerp8(__m256 a, __m256 b, __m256 t) {
+    return _mm256_fmadd_ps(t, _mm256_sub_ps(b, a), a);
+}
+
+// grad() for 8 hashes: the same selects as the scalar code, as masks.
+// g, if given, gets the gradient direction by axis.
+inline __m256 grad8(__m256i hash, __m256 x, __m256 y, __m256 z, __m256* g) {
+    const __m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(15));
+    const __m256 uIsX = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h));
+    const __m256 vIsY = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h));
+    const __m256 vIsX = _mm256_castsi256_ps(_mm256_or_si256(
+        _mm256_cmpeq_epi32(h, _mm256_set1_epi32(12)), _mm256_cmpeq_epi32(h, _mm256_set1_epi32(14))));
+    const __m256 signA = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(1)), 31));
+    const __m256 signB = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(2)), 30));
+
+    const __m256 u = _mm256_blendv_ps(y, x, uIsX);
+    const __m256 v = _mm256_blendv_ps(_mm256_blendv_ps(z, x, vIsX), y, vIsY);
+    if (g) {
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 a = _mm256_xor_ps(one, signA), b = _mm256_xor_ps(one, signB);
+        g[0] = _mm256_add_ps(_mm256_and_ps(uIsX, a), _mm256_and_ps(vIsX, b));
+        g[1] = _mm256_add_ps(_mm256_andnot_ps(uIsX, a), _mm256_and_ps(vIsY, b));
+        g[2] = _mm256_andnot_ps(_mm256_or_ps(vIsY, vIsX), b);
+    }
+    return _mm256_add_ps(_mm256_xor_ps(u, signA), _mm256_xor_ps(v, signB));
+}
+
+inline __m256 perlin8(const int32_t* p, __m256 x, __m256 y, __m256 z) {
+    const Cell8 c = locate(p, x, y, z);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 x1 = _mm256_sub_ps(c.xf, one), y1 = _mm256_sub_ps(c.yf, one), z1 = _mm256_sub_ps(c.zf, one);
+    const __m256 u = fade8(c.xf), v = fade8(c.yf), w = fade8(c.zf);
+
+    const __m256 a = lerp8(grad8(c.hash[0], c.xf, c.yf, c.zf, nullptr), grad8(c.hash[1], x1, c.yf, c.zf, nullptr), u);
+    const __m256 b = lerp8(grad8(c.hash[2], c.xf, y1,   c.zf, nullptr), grad8(c.hash[3], x1, y1,   c.zf, nullptr), u);
+    const __m256 d = lerp8(grad8(c.hash[4], c.xf, c.yf, z1,   nullptr), grad8(c.hash[5], x1, c.yf, z1,   nullptr), u);
+    const __m256 e = lerp8(grad8(c.hash[6], c.xf, y1,   z1,   nullptr), grad8(c.hash[7], x1, y1,   z1,   nullptr), u);
+    return lerp8(lerp8(a, b, v), lerp8(d, e, v), w);
+}
+
+// blend() for 8 points
+inline __m256 blend8(const __m256 c[8], __m256 u, __m256 v, __m256 w, __m256* d) {
+    const __m256 k1 = _mm256_sub_ps(c[1], c[0]);
+    const __m256 k2 = _mm256_sub_ps(c[2], c[0]);
+    const __m256 k3 = _mm256_sub_ps(c[4], c[0]);
+    const __m256 k4 = _mm256_add_ps(_mm256_sub_ps(c[0], c[1]), _mm256_sub_ps(c[3], c[2]));
+    const __m256 k5 = _mm256_add_ps(_mm256_sub_ps(c[0], c[2]), _mm256_sub_ps(c[6], c[4]));
+    const __m256 k6 = _mm256_add_ps(_mm256_sub_ps(c[0], c[1]), _mm256_sub_ps(c[5], c[4]));
+    const __m256 k7 = _mm256_add_ps(_mm256_add_ps(_mm256_sub_ps(c[1], c[0]), _mm256_sub_ps(c[2], c[3])),
+                                    _mm256_add_ps(_mm256_sub_ps(c[4], c[5]), _mm256_sub_ps(c[7], c[6])));
+    const __m256 uv = _mm256_mul_ps(u, v), vw = _mm256_mul_ps(v, w), wu = _mm256_mul_ps(w, u);
+    if (d) {
+        d[0] = _mm256_fmadd_ps(k7, vw, _mm256_fmadd_ps(k6, w, _mm256_fmadd_ps(k4, v, k1)));
+        d[1] = _mm256_fmadd_ps(k7, wu, _mm256_fmadd_ps(k5, w, _mm256_fmadd_ps(k4, u, k2)));
+        d[2] = _mm256_fmadd_ps(k7, uv, _mm256_fmadd_ps(k6, u, _mm256_fmadd_ps(k5, v, k3)));
+    }
+    __m256 n = _mm256_fmadd_ps(k1, u, c[0]);
+    n = _mm256_fmadd_ps(k2, v, n);
+    n = _mm256_fmadd_ps(k3, w, n);
+    n = _mm256_fmadd_ps(k4, uv, n);
+    n = _mm256_fmadd_ps(k5, vw, n);
+    n = _mm256_fmadd_ps(k6, wu, n);
+    return _mm256_fmadd_ps(k7, _mm256_mul_ps(uv, w), n);
+}
+
+inline __m256 perlin8Grad(const int32_t* p, __m256 x, __m256 y, __m256 z, __m256 g[3]) {
+    const Cell8 c = locate(p, x, y, z);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 off[2][3] = {
+        { c.xf, c.yf, c.zf },
+        { _mm256_sub_ps(c.xf, one), _mm256_sub_ps(c.yf, one), _mm256_sub_ps(c.zf, one) }
+    };
+
+    __m256 value[8], gx[8], gy[8], gz[8];
+    for (int k = 0; k < 8; ++k) {
+        __m256 dir[3];
+        value[k] = grad8(c.hash[k], off[k & 1][0], off[(k >> 1) & 1][1], off[k >> 2][2], dir);
+        gx[k] = dir[0]; gy[k] = dir[1]; gz[k] = dir[2];
+    }
+
+    const __m256 u = fade8(c.xf), v = fade8(c.yf), w = fade8(c.zf);
+    __m256 d[3];
+    const __m256 n = blend8(value, u, v, w, d);
+    g[0] = _mm256_fmadd_ps(dfade8(c.xf), d[0], blend8(gx, u, v, w, nullptr));
+    g[1] = _mm256_fmadd_ps(dfade8(c.yf), d[1], blend8(gy, u, v, w, nullptr));
+    g[2] = _mm256_fmadd_ps(dfade8(c.zf), d[2], blend8(gz, u, v, w, nullptr));
+    return n;
+}
+
+// fBm over 8 points; g, if given, gets the gradient
+inline __m256 fbm8(const int32_t* p, __m256 x, __m256 y, __m256 z, __m256* g,
+                   int octaves, float lacunarity, float gain) {
+    __m256 sum = _mm256_setzero_ps();
+    __m256 gsum[3] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+    float amp = 1.0f, freq = 1.0f, norm = 0.0f;
+
+    for (int i = 0; i < octaves; ++i) {
+        const __m256 f = _mm256_set1_ps(freq), a = _mm256_set1_ps(amp);
+        const __m256 px = _mm256_mul_ps(x, f), py = _mm256_mul_ps(y, f), pz = _mm256_mul_ps(z, f);
+        if (g) {
+            __m256 o[3];
+            sum = _mm256_fmadd_ps(a, perlin8Grad(p, px, py, pz, o), sum);
+            const __m256 af = _mm256_set1_ps(amp * freq);
+            for (int k = 0; k < 3; ++k) gsum[k] = _mm256_fmadd_ps(af, o[k], gsum[k]);
+        } else {
+            sum = _mm256_fmadd_ps(a, perlin8(p, px, py, pz), sum);
+        }
+        norm += amp;
+        freq *= lacunarity;
+        amp *= gain;
+    }
+
+    const __m256 inv = _mm256_set1_ps((norm > 0.0f) ? 1.0f / norm : 0.0f);
+    if (g) for (int k = 0; k < 3; ++k) g[k] = _mm256_mul_ps(gsum[k], inv);
+    return _mm256_mul_ps(sum, inv);
+}
+
+}
+
+static const int BATCH = 8;
+
+#else
+
+static const int BATCH = 1;   // no vector path: everything goes through the scalar tail
+
+#endif
+
+void Perlin::perlin3(const float* x, const float* y, const float* z, float* out, int count) const {
+    int i = 0;
+#if defined(NOISE_AVX2)
+    for (; i + BATCH <= count; i += BATCH) {
+        _mm256_storeu_ps(out + i, perlin8(p, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), _mm256_loadu_ps(z + i)));
+    }
+#endif
+    for (; i < count; ++i) out[i] = perlin3(x[i], y[i], z[i]);
+}
+
+void Perlin::perlin3Grad(const float* x, const float* y, const float* z, float* out,
+                         float* gx, float* gy, float* gz, int count) const {
+    int i = 0;
+#if defined(NOISE_AVX2)
+    for (; i + BATCH <= count; i += BATCH) {
+        __m256 g[3];
+        _mm256_storeu_ps(out + i, perlin8Grad(p, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), _mm256_loadu_ps(z + i), g));
+        if (gx) _mm256_storeu_ps(gx + i, g[0]);
+        if (gy) _mm256_storeu_ps(gy + i, g[1]);
+        if (gz) _mm256_storeu_ps(gz + i, g[2]);
+    }
+#endif
+    for (; i < count; ++i) {
+        float g[3];
+        out[i] = perlin3Grad(x[i], y[i], z[i], g);
+        if (gx) gx[i] = g[0];
+        if (gy) gy[i] = g[1];
+        if (gz) gz[i] = g[2];
+    }
+}
+
+void Perlin::fbm3(const float* x, const float* y, const float* z, float* out, int count,
+                  int octaves, float lacunarity, float gain) const {
+    int i = 0;
+#if defined(NOISE_AVX2)
+    for (; i + BATCH <= count; i += BATCH) {
+        _mm256_storeu_ps(out + i, fbm8(p, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), _mm256_loadu_ps(z + i),
+                                       nullptr, octaves, lacunarity, gain));
+    }
+#endif
+    for (; i < count; ++i) out[i] = fbm3(x[i], y[i], z[i], octaves, lacunarity, gain);
+}
+
+void Perlin::fbm3Grad(const float* x, const float* y, const float* z, float* out,
+                      float* gx, float* gy, float* gz, int count,
+                      int octaves, float lacunarity, float gain) const {
+    int i = 0;
+#if defined(NOISE_AVX2)
+    for (; i + BATCH <= count; i += BATCH) {
+        __m256 g[3];
+        _mm256_storeu_ps(out + i, fbm8(p, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), _mm256_loadu_ps(z + i),
+                                       g, octaves, lacunarity, gain));
+        if (gx) _mm256_storeu_ps(gx + i, g[0]);
+        if (gy) _mm256_storeu_ps(gy + i, g[1]);
+        if (gz) _mm256_storeu_ps(gz + i, g[2]);
+    }
+#endif
+    for (; i < count; ++i) {
+        float g[3];
+        out[i] = fbm3Grad(x[i], y[i], z[i], g, octaves, lacunarity, gain);
+        if (gx) gx[i] = g[0];
+        if (gy) gy[i] = g[1];
+        if (gz) gz[i] = g[2];
+    }
+}
+
+void Perlin::curl3(const float* x, const float* y, const float* z,
+                   float* cx, float* cy, float* cz, int count,
+                   int octaves, float lacunarity, float gain) const {
+    int i = 0;
+#if defined(NOISE_AVX2)
+    for (; i + BATCH <= count; i += BATCH) {
+        __m256 d[3][3];
+        for (int k = 0; k < 3; ++k) {
+            fbm8(p, _mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_set1_ps(CURL_OFFSETS[k][0])),
+                    _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_set1_ps(CURL_OFFSETS[k][1])),
+                    _mm256_add_ps(_mm256_loadu_ps(z + i), _mm256_set1_ps(CURL_OFFSETS[k][2])),
+                    d[k], octaves, lacunarity, gain);
+        }
+        _mm256_storeu_ps(cx + i, _mm256_sub_ps(d[2][1], d[1][2]));
+        _mm256_storeu_ps(cy + i, _mm256_sub_ps(d[0][2], d[2][0]));
+        _mm256_storeu_ps(cz + i, _mm256_sub_ps(d[1][0], d[0][1]));
+    }
+#endif
+    for (; i < count; ++i) {
+        float c[3];
+        curl3(x[i], y[i], z[i], c, octaves, lacunarity, gain);
+        cx[i] = c[0]; cy[i] = c[1]; cz[i] = c[2];
+    }
+}
+
+// ---- default noise ----
+// Built during static initialization, before any thread can sample it
+static const Perlin defaultPerlin(1337u);
+
+const Perlin& defaultNoise() {
+    return defaultPerlin;
+}
+
+float perlin3(float x, float y, float z) {
+    return defaultPerlin.perlin3(x, y, z);
+}
+
+float fbm3(float x, float y, float z, int octaves, float lacunarity, float gain) {
+    return defaultPerlin.fbm3(x, y, z, octaves, lacunarity, gain);
+}
+
 } 
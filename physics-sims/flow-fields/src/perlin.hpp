@@ -3,9 +3,61 @@
 
 namespace noise {
 
+// Seeded 3D Perlin noise. The permutation is built when the object is
+// constructed or reseeded and only read afterwards, so one object can be
+// sampled from any number of threads.
+//
+// Every function has a batch form over arrays; with AVX2 and FMA it runs
+// 8 points per iteration using gathers into the permutation table, any
+// remainder and non-AVX2 builds go through the scalar code. Batch and
+// scalar results agree to float rounding.
+//
+// The *Grad variants also return the analytic gradient (d/dx, d/dy, d/dz)
+// of the value, at about the cost of one extra evaluation instead of six
+// for central differences.
+class Perlin {
+public:
+    explicit Perlin(uint32_t seed = 1337u);
+    void setSeed(uint32_t seed);
+    uint32_t seed() const { return seedValue; }
+
+    // Classic 3D Perlin noise in [-1, 1]
+    float perlin3(float x, float y, float z) const;
+    float perlin3Grad(float x, float y, float z, float grad[3]) const;
+
+    // Fractal Brownian Motion built from perlin3, also roughly in [-1, 1]
+    float fbm3(float x, float y, float z, int octaves = 5, float lacunarity = 2.0f, float gain = 0.5f) const;
+    float fbm3Grad(float x, float y, float z, float grad[3],
+                   int octaves = 5, float lacunarity = 2.0f, float gain = 0.5f) const;
+
+    // Divergence-free noise: the curl of three fBm potentials
+    void curl3(float x, float y, float z, float out[3],
+               int octaves = 5, float lacunarity = 2.0f, float gain = 0.5f) const;
+
+    // Batch forms: count points from x, y, z; gx, gy, gz may be null
+    void perlin3(const float* x, const float* y, const float* z, float* out, int count) const;
+    void perlin3Grad(const float* x, const float* y, const float* z, float* out,
+                     float* gx, float* gy, float* gz, int count) const;
+    void fbm3(const float* x, const float* y, const float* z, float* out, int count,
+              int octaves = 5, float lacunarity = 2.0f, float gain = 0.5f) const;
+    void fbm3Grad(const float* x, const float* y, const float* z, float* out,
+                  float* gx, float* gy, float* gz, int count,
+                  int octaves = 5, float lacunarity = 2.0f, float gain = 0.5f) const;
+    void curl3(const float* x, const float* y, const float* z,
+               float* cx, float* cy, float* cz, int count,
+               int octaves = 5, float lacunarity = 2.0f, float gain = 0.5f) const;
+
+private:
+    int32_t p[512];                 // permutation of 0..255, repeated
+    uint32_t seedValue = 0;
+};
+
+// Shared noise with the default seed (1337), built before main runs
+const Perlin& defaultNoise();
+
 // Classic 3D Perlin noise in [-1, 1]
 float perlin3(float x, float y, float z);
 
 // Fractal Brownian Motion built from perlin3, also roughly in [-1, 1]
 float fbm3(float x, float y, float z, int octaves = 5, float lacunarity = 2.0f, float gain = 0.5f);
-} 
\ No newline at end of file
+}
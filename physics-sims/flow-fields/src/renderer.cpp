@@ -0,0 +1,227 @@
+#include "renderer.hpp"
+#include <raymath.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+void FlowRenderer::load(int particles, int trailLength) {
+    unload();
+
+    // Elements are quads of 4 vertices: room for every trail segment (two
+    // vertices each) or for one billboard per particle
+    const int segments = particles * std::max(trailLength - 1, 0);
+    const int elements = std::max((segments * 2 + 3) / 4, particles) + 1;
+    batch = rlLoadRenderBatch(1, elements);
+    loaded = true;
+
+    // White disc with a one-pixel soft edge, as in the ball renderer
+    const int resolution = 32;
+    Image img = GenImageColor(resolution, resolution, BLANK);
+    Color* pixels = (Color*)img.data;
+    const float c = 0.5f * resolution;
+    for (int y = 0; y < resolution; y++) {
+        for (int x = 0; x < resolution; x++) {
+            float dx = x + 0.5f - c;
+            float dy = y + 0.5f - c;
+            float a = Clamp(c - sqrtf(dx*dx + dy*dy), 0.0f, 1.0f);
+            pixels[y * resolution + x] = { 255, 255, 255, (unsigned char)(a * 255.0f) };
+        }
+    }
+    dot = LoadTextureFromImage(img);
+    SetTextureFilter(dot, TEXTURE_FILTER_BILINEAR);
+    UnloadImage(img);
+}
+
+void FlowRenderer::unload() {
+    if (loaded) rlUnloadRenderBatch(batch);
+    if (dot.id != 0) UnloadTexture(dot);
+    batch = {};
+    dot = {};
+    loaded = false;
+}
+
+// Draws what is queued in the default batch, so it stays behind us, and
+// collects our vertices in our own
+void FlowRenderer::begin() {
+    rlSetRenderBatchActive(&batch);
+}
+
+// Uploads and draws our batch, then hands back the default one
+void FlowRenderer::end() {
+    rlSetRenderBatchActive(nullptr);
+}
+
+// ---- view grid ----
+static void Grow(BoundingBox& b, Vector3 p) {
+    b.min = Vector3Min(b.min, p);
+    b.max = Vector3Max(b.max, p);
+}
+
+template <typename Extent>
+float FlowRenderer::bin(int count, const Camera3D& cam, Extent extent) {
+    const BoundingBox empty = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+    cells.assign(GRID * GRID * GRID, Cell{ empty, 0, 0, false, 0.0f });
+    order.resize(count);
+    cellOf.resize(count);
+    last = {};
+    last.cells = (int)cells.size();
+    last.particles = count;
+
+    // Grid over the heads, then counting sort by cell; particles keep their
+    // order within a cell
+    BoundingBox all = empty, scratch = empty;
+    for (int i = 0; i < count; ++i) Grow(all, extent(i, scratch));
+    Vector3 size = Vector3Subtract(all.max, all.min);
+    Vector3 scale = { GRID / std::max(size.x, 1e-3f), GRID / std::max(size.y, 1e-3f), GRID / std::max(size.z, 1e-3f) };
+
+    for (int i = 0; i < count; ++i) {
+        BoundingBox b = empty;
+        Vector3 h = extent(i, b);
+        int cx = std::min((int)((h.x - all.min.x) * scale.x), GRID - 1);
+        int cy = std::min((int)((h.y - all.min.y) * scale.y), GRID - 1);
+        int cz = std::min((int)((h.z - all.min.z) * scale.z), GRID - 1);
+        int c = (cz * GRID + cy) * GRID + cx;
+        cellOf[i] = c;
+        Cell& cell = cells[c];
+        Grow(cell.bounds, b.min);
+        Grow(cell.bounds, b.max);
+        cell.count++;
+    }
+    int at = 0;
+    for (Cell& cell : cells) { cell.begin = at; at += cell.count; cell.count = 0; }
+    for (int i = 0; i < count; ++i) {
+        Cell& cell = cells[cellOf[i]];
+        order[cell.begin + cell.count++] = i;
+    }
+
+    // Visibility and distance, against raylib's default clip distances
+    const int height = std::max(GetScreenHeight(), 1);
+    const float aspect = (float)GetScreenWidth() / height;
+    const Frustum frustum = Frustum::fromCamera(cam, aspect, 0.01f, 1000.0f);
+    for (Cell& cell : cells) {
+        if (cell.count == 0) continue;
+        cell.visible = !cull || frustum.intersects(cell.bounds);
+        if (cull) {
+            Vector3 nearest = Vector3Clamp(cam.position, cell.bounds.min, cell.bounds.max);
+            cell.distance = Vector3Distance(cam.position, nearest);
+        }
+        if (cell.visible) {
+            last.visibleCells++;
+            last.visibleParticles += cell.count;
+        }
+    }
+
+    return (cam.projection == CAMERA_ORTHOGRAPHIC) ? cam.fovy / height
+                                                   : 2.0f * tanf(0.5f * cam.fovy * DEG2RAD) / height;
+}
+
+// ---- drawing ----
+void FlowRenderer::drawTrails(const TrailArena& trails, const Camera3D& cam, Color color) {
+    const int cap = trails.capacity();
+    if (!loaded || cap < 2 || trails.count() == 0) return;
+
+    if ((int)fade.size() != cap || fadeAlpha != color.a) {
+        fade.resize(cap);
+        for (int k = 0; k < cap; ++k) fade[k] = (unsigned char)(color.a * k / (cap - 1));
+        fadeAlpha = color.a;
+    }
+
+    // A cell's box holds every point of its trails, so a trail that curves
+    // out of the head's cell is never culled while part of it is on screen;
+    // the points drawn at any level of detail are among them
+    bin(trails.count(), cam, [&](int i, BoundingBox& b) {
+        TrailArena::View v = trails.view(i);
+        for (int k = 0; k < v.firstLen; ++k) Grow(b, v.first[k]);
+        for (int k = 0; k < v.secondLen; ++k) Grow(b, v.second[k]);
+        return v.secondLen ? v.second[v.secondLen - 1] : v.first[v.firstLen - 1];
+    });
+
+    begin();
+    rlBegin(RL_LINES);
+    for (const Cell& cell : cells) {
+        if (!cell.visible) continue;
+
+        // Points drawn: the newest, then every stride-th one back to oldest
+        int stride = 1, oldest = 0;
+        if (cull && cell.distance >= lodFar) { stride = 4; oldest = (cap - 1) / 2; }
+        else if (cull && cell.distance >= lodNear) stride = 2;
+        const int first = cap - 1 - (cap - 1 - oldest) / stride * stride;
+        last.vertices += cell.count * 2 * ((cap - 1 - first) / stride);
+
+        for (int j = cell.begin; j < cell.begin + cell.count; ++j) {
+            TrailArena::View v = trails.view(order[j]);
+
+            // Oldest to newest across both runs of the ring; every segment
+            // is its two ends, shaded by their age
+            auto at = [&](int k) { return (k < v.firstLen) ? v.first[k] : v.second[k - v.firstLen]; };
+            Vector3 prev = at(first);
+            for (int k = first + stride; k < cap; k += stride) {
+                Vector3 p = at(k);
+                rlColor4ub(color.r, color.g, color.b, fade[k - stride]);
+                rlVertex3f(prev.x, prev.y, prev.z);
+                rlColor4ub(color.r, color.g, color.b, fade[k]);
+                rlVertex3f(p.x, p.y, p.z);
+                prev = p;
+            }
+        }
+    }
+    rlEnd();
+    end();
+}
+
+void FlowRenderer::drawPoints(const ParticleSystem& ps, const Camera3D& cam, float radius, Color color) {
+    if (!loaded || ps.count() == 0) return;
+
+    const float pixel = bin(ps.count(), cam, [&](int i, BoundingBox& b) {
+        Vector3 p = ps.position(i);
+        Grow(b, p);
+        return p;
+    });
+
+    // Billboard axes: the camera's right and up, scaled to the radius
+    Vector3 forward = Vector3Normalize(Vector3Subtract(cam.target, cam.position));
+    Vector3 axis = Vector3Normalize(Vector3CrossProduct(forward, cam.up));
+    Vector3 up = Vector3Scale(Vector3CrossProduct(axis, forward), radius);
+    Vector3 right = Vector3Scale(axis, radius);
+
+    // Cells where a particle is under a pixel across are drawn as dots
+    const bool ortho = cam.projection == CAMERA_ORTHOGRAPHIC;
+    auto isDot = [&](const Cell& cell) {
+        return cull && 2.0f * radius < pixel * (ortho ? 1.0f : cell.distance);
+    };
+
+    begin();
+    rlSetTexture(dot.id);
+    rlBegin(RL_QUADS);
+    rlColor4ub(color.r, color.g, color.b, color.a);
+    for (const Cell& cell : cells) {
+        if (!cell.visible || isDot(cell)) continue;
+        last.vertices += cell.count * 4;
+        for (int j = cell.begin; j < cell.begin + cell.count; ++j) {
+            Vector3 p = ps.position(order[j]);
+            rlTexCoord2f(0.0f, 0.0f); rlVertex3f(p.x - right.x + up.x, p.y - right.y + up.y, p.z - right.z + up.z);
+            rlTexCoord2f(0.0f, 1.0f); rlVertex3f(p.x - right.x - up.x, p.y - right.y - up.y, p.z - right.z - up.z);
+            rlTexCoord2f(1.0f, 1.0f); rlVertex3f(p.x + right.x - up.x, p.y + right.y - up.y, p.z + right.z - up.z);
+            rlTexCoord2f(1.0f, 0.0f); rlVertex3f(p.x + right.x + up.x, p.y + right.y + up.y, p.z + right.z + up.z);
+        }
+    }
+    rlEnd();
+    rlSetTexture(0);
+
+    // Dots: a line about a pixel and a half long across the screen, so it
+    // lights at least one pixel
+    rlBegin(RL_LINES);
+    rlColor4ub(color.r, color.g, color.b, color.a);
+    for (const Cell& cell : cells) {
+        if (!cell.visible || !isDot(cell)) continue;
+        last.vertices += cell.count * 2;
+        Vector3 half = Vector3Scale(axis, 0.75f * pixel * (ortho ? 1.0f : std::max(cell.distance, 1.0f)));
+        for (int j = cell.begin; j < cell.begin + cell.count; ++j) {
+            Vector3 p = ps.position(order[j]);
+            rlVertex3f(p.x - half.x, p.y - half.y, p.z - half.z);
+            rlVertex3f(p.x + half.x, p.y + half.y, p.z + half.z);
+        }
+    }
+    rlEnd();
+    end();
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <raylib.h>
+#include <rlgl.h>
+#include <vector>
+#include "frustum.hpp"
+#include "particle.hpp"
+#include "trail.hpp"
+
+// What the last draw kept: grid cells and particles in view, and the
+// vertices written for them
+struct RenderStats {
+    int cells = 0, visibleCells = 0;
+    int particles = 0, visibleParticles = 0;
+    int vertices = 0;
+};
+
+// Draws all trails, or all particles, in one go. The renderer owns an rlgl
+// render batch sized for a whole frame, so every vertex is written into one
+// dynamic vertex buffer that is uploaded once and drawn with a single call,
+// instead of one DrawLine3D per segment or one DrawSphere mesh per particle.
+//
+// Each draw first sorts the particles into a coarse grid over their
+// bounds; a cell's box covers its particles and every point of their
+// trails. Cells outside the camera's frustum are skipped, and cells far
+// from the camera get less detail: trails lose every other point past
+// lodNear, and past lodFar keep every 4th point of their newer half;
+// particles smaller than a pixel become one-pixel line dots instead of
+// textured quads. So the vertex count follows what is on screen.
+class FlowRenderer {
+public:
+    bool cull = true;          // false: draw everything at full detail
+    float lodNear = 150.0f;    // world units
+    float lodFar  = 300.0f;
+
+    void load(int particles, int trailLength);     // needs a GL context (after InitWindow)
+    void unload();
+
+    // Segments oldest to newest; alpha fades from 0 at the oldest point to
+    // color.a at the newest
+    void drawTrails(const TrailArena& trails, const Camera3D& cam, Color color);
+
+    // Camera-facing round billboards, radius in world units
+    void drawPoints(const ParticleSystem& ps, const Camera3D& cam, float radius, Color color);
+
+    const RenderStats& stats() const { return last; }
+
+private:
+    rlRenderBatch batch{};
+    bool loaded = false;
+    Texture2D dot = {};
+    std::vector<unsigned char> fade;               // alpha per trail point, oldest first
+    int fadeAlpha = -1;                            // color.a fade was built for
+
+    // ---- view grid ----
+    static const int GRID = 8;                     // cells per axis
+
+    struct Cell {
+        BoundingBox bounds;
+        int begin, count;                          // range of order
+        bool visible;
+        float distance;                            // from the camera to the box; 0 with cull off
+    };
+    std::vector<Cell> cells;                       // GRID^3
+    std::vector<int> order;                        // particle indices, grouped by cell
+    std::vector<int> cellOf;                       // per particle
+    RenderStats last;
+
+    // Sorts count particles into cells by their head and grows each cell's
+    // box over the particle (extent(i, box) returns the head and grows box),
+    // then finds the cells cam can see. Returns the world size of one pixel
+    // at distance 1 (perspective) or at any distance (orthographic).
+    template <typename Extent>
+    float bin(int count, const Camera3D& cam, Extent extent);
+
+    void begin();
+    void end();
+};
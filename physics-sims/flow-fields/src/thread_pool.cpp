@@ -0,0 +1,62 @@
+#include "thread_pool.hpp"
+
+ThreadPool::ThreadPool(int threads) {
+    if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+    for (int i = 1; i < threads; i++) workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    start.notify_all();
+    for (auto& w : workers) w.join();
+}
+
+void ThreadPool::drain() {
+    for (int i = nextTask.fetch_add(1); i < taskCount; i = nextTask.fetch_add(1)) {
+        (*task)(i);
+    }
+}
+
+void ThreadPool::workerLoop() {
+    unsigned seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            start.wait(lock, [&] { return stopping || batch != seen; });
+            if (stopping) return;
+            seen = batch;
+        }
+
+        drain();
+
+        std::lock_guard<std::mutex> lock(mtx);
+        if (--running == 0) finished.notify_one();
+    }
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)>& fn) {
+    if (count <= 0) return;
+    if (workers.empty() || count == 1) {
+        for (int i = 0; i < count; i++) fn(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        task = &fn;
+        taskCount = count;
+        nextTask.store(0);
+        running = (int)workers.size();
+        batch++;
+    }
+    start.notify_all();
+
+    drain();
+
+    std::unique_lock<std::mutex> lock(mtx);
+    finished.wait(lock, [&] { return running == 0; });
+    task = nullptr;
+}
@@ -0,0 +1,28 @@
+#include "trail.hpp"
+#include <algorithm>
+
+void TrailArena::init(int count, int capacity) {
+    cap = std::max(capacity, 0);
+    points.assign((size_t)std::max(count, 0) * cap, Vector3{0, 0, 0});
+    head.assign((size_t)std::max(count, 0), 0);
+}
+
+void TrailArena::reset(int i, Vector3 p) {
+    Vector3* ring = points.data() + (size_t)i * cap;
+    std::fill(ring, ring + cap, p);
+    head[i] = 0;
+}
+
+void TrailArena::push(int i, Vector3 p) {
+    if (cap == 0) return;
+    uint32_t h = head[i];
+    points[(size_t)i * cap + h] = p;
+    head[i] = (h + 1 == (uint32_t)cap) ? 0 : h + 1;
+}
+
+TrailArena::View TrailArena::view(int i) const {
+    const Vector3* ring = points.data() + (size_t)i * cap;
+    int h = (int)head[i];
+    return { ring + h, cap - h, ring, h };
+}
+
@@ -0,0 +1,33 @@
+#pragma once
+#include <raylib.h>
+#include <cstdint>
+#include <vector>
+
+// Trails for every particle in one contiguous arena: particle i owns the
+// fixed-capacity ring points[i*capacity .. (i+1)*capacity). Pushing a point
+// overwrites the oldest one and advances the ring's head, so a frame costs
+// one store per particle and no allocation after init(). FlowRenderer
+// (renderer.hpp) draws them.
+class TrailArena {
+public:
+    // A ring read oldest to newest: first[0..firstLen) then second[0..secondLen)
+    struct View {
+        const Vector3* first;
+        int firstLen;
+        const Vector3* second;
+        int secondLen;
+    };
+
+    void init(int count, int capacity);
+    void reset(int i, Vector3 p);      // every point of the ring at p
+    void push(int i, Vector3 p);       // O(1): replaces the oldest point
+
+    int count() const { return (int)head.size(); }
+    int capacity() const { return cap; }
+    View view(int i) const;
+
+private:
+    int cap = 0;
+    std::vector<Vector3> points;       // count * cap
+    std::vector<uint32_t> head;        // per ring: slot of the oldest point
+};
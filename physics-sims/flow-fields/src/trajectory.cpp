@@ -0,0 +1,329 @@
+#include "trajectory.hpp"
+#include <algorithm>
+#include <iostream>
+
+// ---- writer ----
+TrajectoryWriter::~TrajectoryWriter() {
+    close();
+}
+
+bool TrajectoryWriter::open(const std::string& path, const ParticleSystem& ps, BoundingBox box, float dt,
+                            int stepsPerFrame, bool float16, int chunkParticles) {
+    close();
+
+    file = fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "TrajectoryWriter: cannot open " << path << std::endl;
+        return false;
+    }
+
+    header = {};
+    header.magic = TRAJECTORY_MAGIC;
+    header.flags = float16 ? TRAJECTORY_FLOAT16 : 0;
+    header.particleCount = (uint32_t)ps.count();
+    header.chunkParticles = (uint32_t)std::max(chunkParticles, 1);
+    header.stepsPerFrame = (uint32_t)std::max(stepsPerFrame, 1);
+    header.dt = dt;
+    header.boxMin[0] = box.min.x; header.boxMin[1] = box.min.y; header.boxMin[2] = box.min.z;
+    header.boxMax[0] = box.max.x; header.boxMax[1] = box.max.y; header.boxMax[2] = box.max.z;
+    header.seed = ps.seed;
+    if (TrajectoryPayloadBytes(header) > UINT32_MAX) {
+        std::cerr << "TrajectoryWriter: " << ps.count() << " particles do not fit in a frame" << std::endl;
+        fclose(file);
+        file = nullptr;
+        return false;
+    }
+    failed = fwrite(&header, sizeof(header), 1, file) != 1;
+    offset = sizeof(header);
+
+    captured = 0;
+    index.clear();
+    closing = false;
+    writer = std::thread(&TrajectoryWriter::writerLoop, this);
+    return true;
+}
+
+void TrajectoryWriter::capture(const ParticleSystem& ps, uint64_t step, float time) {
+    if (!file) return;
+
+    Snapshot s;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!spare.empty()) {
+            s = std::move(spare.back());
+            spare.pop_back();
+        }
+    }
+
+    // A system resized since open() is cut or padded to the header's count
+    const size_t n = header.particleCount;
+    const size_t have = std::min(n, (size_t)ps.count());
+    ParticleSystem::State st = ps.state();
+    const float* arrays[6] = { st.px, st.py, st.pz, st.vx, st.vy, st.vz };
+    s.step = step;
+    s.time = time;
+    s.values.resize(6 * n);
+    for (int c = 0; c < 6; ++c) {
+        std::copy(arrays[c], arrays[c] + have, s.values.begin() + c * n);
+        std::fill(s.values.begin() + c * n + have, s.values.begin() + (c + 1) * n, 0.0f);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(std::move(s));
+    }
+    ready.notify_one();
+    captured++;
+}
+
+int TrajectoryWriter::backlog() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return (int)pending.size();
+}
+
+void TrajectoryWriter::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        ready.wait(lock, [this] { return closing || !pending.empty(); });
+        if (pending.empty()) return;   // closing and drained
+
+        Snapshot s = std::move(pending.front());
+        pending.pop_front();
+
+        lock.unlock();
+        writeFrame(s);
+        lock.lock();
+
+        spare.push_back(std::move(s));
+    }
+}
+
+void TrajectoryWriter::writeFrame(const Snapshot& s) {
+    const size_t n = header.particleCount;
+    const size_t chunk = header.chunkParticles;
+    const uint32_t valueBytes = TrajectoryValueBytes(header);
+
+    // Regroup the system-wide runs chunk by chunk
+    payload.assign(TrajectoryPayloadBytes(header), 0);
+    uint8_t* out = payload.data();
+    for (size_t begin = 0; begin < n; begin += chunk) {
+        const size_t count = std::min(chunk, n - begin);
+        for (int c = 0; c < 6; ++c) {
+            const float* in = s.values.data() + c * n + begin;
+            if (valueBytes == 2) {
+                for (size_t j = 0; j < count; ++j) {
+                    uint16_t h = FloatToHalf(in[j]);
+                    memcpy(out + 2 * j, &h, 2);
+                }
+            } else {
+                memcpy(out, in, count * 4);
+            }
+            out += count * valueBytes;
+        }
+    }
+
+    TrajectoryFrameHeader fh = { s.step, s.time, (uint32_t)payload.size() };
+    if (fwrite(&fh, sizeof(fh), 1, file) != 1 ||
+        fwrite(payload.data(), 1, payload.size(), file) != payload.size()) failed = true;
+
+    index.push_back(offset);
+    offset += sizeof(fh) + fh.payloadBytes;
+}
+
+bool TrajectoryWriter::close() {
+    if (!file) return true;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+    }
+    ready.notify_one();
+    writer.join();
+
+    TrajectoryFooter footer = {};
+    footer.indexOffset = offset;
+    footer.frameCount = (uint32_t)index.size();
+    footer.magic = TRAJECTORY_FOOTER;
+    if (fwrite(index.data(), sizeof(uint64_t), index.size(), file) != index.size() ||
+        fwrite(&footer, sizeof(footer), 1, file) != 1) failed = true;
+    if (fclose(file) != 0) failed = true;
+    file = nullptr;
+    spare.clear();
+    return !failed;
+}
+
+// ---- reader ----
+// Values in float16 frames are only 2-byte aligned, so read through memcpy
+template <typename T>
+static T ReadAt(const uint8_t* p) {
+    T value;
+    memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+bool TrajectoryReader::open(const std::string& path) {
+    close();
+
+    if (!file.open(path)) {
+        std::cerr << "TrajectoryReader: cannot map " << path << std::endl;
+        return false;
+    }
+    // A header whose frame would not fit the file even once is not read
+    // further: its particle count alone could ask for gigabytes per frame
+    if (file.size() < sizeof(TrajectoryHeader) ||
+        (header = ReadAt<TrajectoryHeader>(file.data())).magic != TRAJECTORY_MAGIC ||
+        header.chunkParticles == 0 ||
+        !validFrame(sizeof(TrajectoryHeader), file.size())) {
+        std::cerr << "TrajectoryReader: " << path << " is not a trajectory file" << std::endl;
+        close();
+        return false;
+    }
+
+    bool indexed = false;
+    if (file.size() >= sizeof(TrajectoryHeader) + sizeof(TrajectoryFooter)) {
+        TrajectoryFooter footer = ReadAt<TrajectoryFooter>(file.data() + file.size() - sizeof(TrajectoryFooter));
+        uint64_t indexEnd = footer.indexOffset + (uint64_t)footer.frameCount * sizeof(uint64_t);
+        indexed = footer.magic == TRAJECTORY_FOOTER &&
+                  footer.indexOffset >= sizeof(TrajectoryHeader) &&
+                  footer.indexOffset <= file.size() &&
+                  indexEnd + sizeof(TrajectoryFooter) == file.size();
+        if (indexed) {
+            index = file.data() + footer.indexOffset;
+            frames = (int)footer.frameCount;
+        }
+
+        // Every indexed frame has to lie in front of the index; a damaged
+        // index is dropped and the frames walked as if it were missing
+        for (int f = 0; indexed && f < frames; f++) {
+            if (!validFrame(frameOffset(f), footer.indexOffset)) {
+                std::cerr << "TrajectoryReader: " << path << " has a damaged index" << std::endl;
+                indexed = false;
+                index = nullptr;
+                frames = 0;
+            }
+        }
+    }
+
+    // The writer was not closed cleanly: walk the frames once instead.
+    // A file with no frames is of no use either way.
+    if ((!indexed && !rebuild()) || frames == 0) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool TrajectoryReader::rebuild() {
+    rebuiltIndex.clear();
+
+    const uint64_t frameBytes = sizeof(TrajectoryFrameHeader) + TrajectoryPayloadBytes(header);
+    uint64_t off = sizeof(TrajectoryHeader);
+    while (validFrame(off, file.size())) {   // stops at a torn write
+        rebuiltIndex.push_back(off);
+        off += frameBytes;
+    }
+
+    std::cerr << "TrajectoryReader: no index, recovered " << rebuiltIndex.size() << " frames" << std::endl;
+    index = (const uint8_t*)rebuiltIndex.data();
+    frames = (int)rebuiltIndex.size();
+    return frames > 0;
+}
+
+void TrajectoryReader::close() {
+    file.close();
+    rebuiltIndex.clear();
+    header = {};
+    index = nullptr;
+    frames = 0;
+}
+
+uint64_t TrajectoryReader::frameOffset(int frame) const {
+    return ReadAt<uint64_t>(index + (size_t)frame * sizeof(uint64_t));
+}
+
+// A frame at offset whose header and the payload the header describes end
+// by end, with the payload size every frame of this file has
+bool TrajectoryReader::validFrame(uint64_t offset, uint64_t end) const {
+    const uint64_t payloadBytes = TrajectoryPayloadBytes(header);
+    if (offset < sizeof(TrajectoryHeader) || end > file.size() || offset > end ||
+        end - offset < sizeof(TrajectoryFrameHeader) ||
+        end - offset - sizeof(TrajectoryFrameHeader) < payloadBytes) return false;
+    return ReadAt<TrajectoryFrameHeader>(file.data() + offset).payloadBytes == payloadBytes;
+}
+
+TrajectoryFrameHeader TrajectoryReader::frameHeader(int frame) const {
+    return ReadAt<TrajectoryFrameHeader>(file.data() + frameOffset(frame));
+}
+
+const uint8_t* TrajectoryReader::frameData(int frame) const {
+    return file.data() + frameOffset(frame) + sizeof(TrajectoryFrameHeader);
+}
+
+uint64_t TrajectoryReader::step(int frame) const {
+    if (frame < 0 || frame >= frames) return 0;
+    return frameHeader(frame).step;
+}
+
+float TrajectoryReader::time(int frame) const {
+    if (frame < 0 || frame >= frames) return 0.0f;
+    return frameHeader(frame).time;
+}
+
+void TrajectoryReader::readFrame(int frame, Frame& out) const {
+    const size_t n = header.particleCount;
+    const size_t chunk = header.chunkParticles;
+    const uint32_t valueBytes = TrajectoryValueBytes(header);
+    std::vector<float>* arrays[6] = { &out.px, &out.py, &out.pz, &out.vx, &out.vy, &out.vz };
+    for (std::vector<float>* a : arrays) a->resize(n);
+    if (frame < 0 || frame >= frames) return;
+
+    const uint8_t* in = frameData(frame);
+    for (size_t begin = 0; begin < n; begin += chunk) {
+        const size_t count = std::min(chunk, n - begin);
+        for (int c = 0; c < 6; ++c) {
+            float* dst = arrays[c]->data() + begin;
+            if (valueBytes == 2) {
+                for (size_t j = 0; j < count; ++j) dst[j] = HalfToFloat(ReadAt<uint16_t>(in + 2 * j));
+            } else {
+                memcpy(dst, in, count * 4);
+            }
+            in += count * valueBytes;
+        }
+    }
+}
+
+void TrajectoryReader::particle(int frame, int i, Vector3* position, Vector3* velocity) const {
+    const size_t n = header.particleCount;
+    const size_t chunk = header.chunkParticles;
+    const uint32_t valueBytes = TrajectoryValueBytes(header);
+    if (frame < 0 || frame >= frames || i < 0 || (size_t)i >= n) return;
+
+    // Chunks before this one are full; within it, run c starts c * count in
+    const size_t begin = (size_t)i / chunk * chunk;
+    const size_t count = std::min(chunk, n - begin);
+    const uint8_t* base = frameData(frame) + begin * 6 * valueBytes + ((size_t)i - begin) * valueBytes;
+    float v[6];
+    for (int c = 0; c < 6; ++c) {
+        const uint8_t* p = base + c * count * valueBytes;
+        v[c] = (valueBytes == 2) ? HalfToFloat(ReadAt<uint16_t>(p)) : ReadAt<float>(p);
+    }
+    if (position) *position = { v[0], v[1], v[2] };
+    if (velocity) *velocity = { v[3], v[4], v[5] };
+}
+
+void TrajectoryReader::readTrack(int i, std::vector<TrackPoint>& out, int first, int last) const {
+    out.clear();
+    if (i < 0 || i >= particleCount()) return;
+    if (last < 0 || last >= frames) last = frames - 1;
+    first = std::max(first, 0);
+
+    out.reserve(std::max(last - first + 1, 0));
+    for (int f = first; f <= last; ++f) {
+        TrajectoryFrameHeader fh = frameHeader(f);
+        TrackPoint p;
+        p.step = fh.step;
+        p.time = fh.time;
+        particle(f, i, &p.position, &p.velocity);
+        out.push_back(p);
+    }
+}
@@ -0,0 +1,213 @@
+#pragma once
+#include <raylib.h>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "mapped_file.hpp"
+#include "particle.hpp"
+
+// Particle trajectories: positions and velocities of every particle, saved
+// every few simulation steps.
+//
+// File layout (little endian, records 8-byte aligned):
+//   TrajectoryHeader
+//   frames              TrajectoryFrameHeader, then the particles in chunks
+//   frame index         uint64 file offset of every frame
+//   TrajectoryFooter    last bytes of the file
+//
+// A frame splits the particles into chunks of chunkParticles (the last one
+// may be shorter). A chunk stores x, y, z, vx, vy, vz, each as one run over
+// its particles, so reading one particle touches one chunk of the frame.
+// Nothing is compressed: every offset follows from the header and the
+// index. Values are float32, or float16 with TRAJECTORY_FLOAT16 (11
+// significant bits: positions near 100 land within 0.03 units). Frames
+// carry their own step and time, so a file whose footer never got written
+// can still be read by walking the frames.
+const uint32_t TRAJECTORY_MAGIC   = 0x31544646;   // "FFT1"
+const uint32_t TRAJECTORY_FOOTER  = 0x58444e49;   // "INDX"
+const uint32_t TRAJECTORY_FLOAT16 = 1;
+
+struct TrajectoryHeader {
+    uint32_t magic;
+    uint32_t flags;             // TRAJECTORY_FLOAT16
+    uint32_t particleCount;
+    uint32_t chunkParticles;
+    uint32_t stepsPerFrame;
+    float dt;                   // seconds per simulation step
+    float boxMin[3];
+    float boxMax[3];
+    uint64_t seed;
+};
+
+struct TrajectoryFrameHeader {
+    uint64_t step;
+    float time;
+    uint32_t payloadBytes;      // all chunks, padded to 8 bytes; TrajectoryPayloadBytes()
+};
+
+struct TrajectoryFooter {
+    uint64_t indexOffset;
+    uint32_t frameCount;
+    uint32_t magic;
+};
+
+// IEEE half precision, rounding to nearest even; out of range values
+// become infinity
+inline uint16_t FloatToHalf(float f) {
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000;
+    uint32_t mag = x & 0x7fffffff;
+
+    if (mag >= 0x7f800000) return (uint16_t)(sign | 0x7c00 | (mag > 0x7f800000 ? 0x200 : 0));
+    if (mag >= 0x477ff000) return (uint16_t)(sign | 0x7c00);   // rounds past 65504
+    if (mag < 0x38800000) {
+        // Subnormal half, in units of 2^-24: shift the full mantissa into
+        // place, then round
+        if (mag < 0x33000000) return (uint16_t)sign;
+        uint32_t m = (mag & 0x7fffff) | 0x800000;
+        int shift = 126 - (int)(mag >> 23);
+        uint32_t h = m >> shift;
+        uint32_t rest = m & ((1u << shift) - 1), half = 1u << (shift - 1);
+        if (rest > half || (rest == half && (h & 1))) h++;
+        return (uint16_t)(sign | h);
+    }
+    uint32_t h = ((mag >> 13) - (112 << 10));
+    uint32_t rest = mag & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (h & 1))) h++;
+    return (uint16_t)(sign | h);
+}
+
+inline float HalfToFloat(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t e = (h >> 10) & 0x1f, m = h & 0x3ff;
+    uint32_t x;
+    if (e == 0x1f) x = sign | 0x7f800000 | (m << 13);
+    else if (e != 0) x = sign | ((e + 112) << 23) | (m << 13);
+    else if (m == 0) x = sign;
+    else {
+        // Subnormal: normalize the mantissa
+        e = 113;
+        while (!(m & 0x400)) { m <<= 1; e--; }
+        x = sign | (e << 23) | ((m & 0x3ff) << 13);
+    }
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+inline uint32_t TrajectoryValueBytes(const TrajectoryHeader& h) {
+    return (h.flags & TRAJECTORY_FLOAT16) ? 2 : 4;
+}
+
+// Kept in 64 bits: a header can claim more than a frame header can hold,
+// which the writer refuses and the reader rejects
+inline uint64_t TrajectoryPayloadBytes(const TrajectoryHeader& h) {
+    uint64_t bytes = (uint64_t)h.particleCount * 6 * TrajectoryValueBytes(h);
+    return (bytes + 7) & ~(uint64_t)7;
+}
+
+// Streams frames to disk from a background thread. capture() only copies
+// the particle arrays into a recycled buffer; conversion to float16 and
+// the writes happen on the writer, so stepping never waits on the file.
+class TrajectoryWriter {
+public:
+    TrajectoryWriter() = default;
+    ~TrajectoryWriter();
+    TrajectoryWriter(const TrajectoryWriter&) = delete;
+    TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+    // stepsPerFrame and dt are recorded for readers; capture() decides
+    // which steps are saved
+    bool open(const std::string& path, const ParticleSystem& ps, BoundingBox box, float dt,
+              int stepsPerFrame, bool float16, int chunkParticles = 4096);
+    void capture(const ParticleSystem& ps, uint64_t step, float time);
+    bool close();   // drains the queue, then writes the index and footer; false if a write failed
+
+    bool isOpen() const { return file != nullptr; }
+    uint32_t frameCount() const { return captured; }
+    int backlog();                                 // frames captured but not yet written
+
+private:
+    struct Snapshot {
+        uint64_t step;
+        float time;
+        std::vector<float> values;                 // x, y, z, vx, vy, vz runs, count each
+    };
+
+    FILE* file = nullptr;
+    std::thread writer;
+    TrajectoryHeader header = {};
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<Snapshot> pending;
+    std::vector<Snapshot> spare;                   // written snapshots, reused by capture
+    bool closing = false;
+
+    uint32_t captured = 0;                         // simulation side
+
+    std::vector<uint64_t> index;                   // writer side
+    std::vector<uint8_t> payload;
+    uint64_t offset = 0;
+    bool failed = false;
+
+    void writerLoop();
+    void writeFrame(const Snapshot& s);
+};
+
+// Random access to a trajectory file. The file is memory mapped and frames
+// are found through the index, so reading a frame or one particle's track
+// only touches the pages it needs, however long the run was. open() checks
+// every indexed frame against the file, so reads never leave the mapping.
+class TrajectoryReader {
+public:
+    struct Frame {
+        std::vector<float> px, py, pz, vx, vy, vz;  // particleCount() each
+    };
+
+    struct TrackPoint {
+        uint64_t step;
+        float time;
+        Vector3 position;
+        Vector3 velocity;
+    };
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return file.isOpen(); }
+    const TrajectoryHeader& info() const { return header; }
+    int frameCount() const { return frames; }
+    int particleCount() const { return (int)header.particleCount; }
+    uint64_t step(int frame) const;
+    float time(int frame) const;
+
+    // Every particle of a frame
+    void readFrame(int frame, Frame& out) const;
+
+    // Particle i in one frame: reads six values from one chunk
+    void particle(int frame, int i, Vector3* position, Vector3* velocity) const;
+
+    // Particle i in frames [first, last]; last < 0 means the last frame
+    void readTrack(int i, std::vector<TrackPoint>& out, int first = 0, int last = -1) const;
+
+private:
+    MappedFile file;
+    TrajectoryHeader header = {};
+    std::vector<uint64_t> rebuiltIndex;            // only for files without a footer
+    const uint8_t* index = nullptr;                // frames uint64 offsets
+    int frames = 0;
+
+    uint64_t frameOffset(int frame) const;
+    bool validFrame(uint64_t offset, uint64_t end) const;
+    TrajectoryFrameHeader frameHeader(int frame) const;
+    const uint8_t* frameData(int frame) const;     // first chunk of the frame
+    bool rebuild();
+};
@@ -0,0 +1,107 @@
+// Reads a trajectory file (trajectory.hpp) and reports what the tornado
+// does to the particles: frame by frame, how many are in the vortex core
+// and how fast they rise; track by track, how long particles stay in the
+// core and how far they travel vertically. Frames and tracks are read
+// straight from the mapping, one at a time.
+//
+// usage: trajectory_stats file [-c coreRadius] [-p tracks]
+#include "trajectory.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+struct Options {
+    const char* path = nullptr;
+    float coreRadius = 12.0f;   // the tornado's Vortex::coreR, around the y axis
+    int tracks = 1000;
+};
+
+int main(int argc, char** argv) {
+    Options o;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-c") && i + 1 < argc) o.coreRadius = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "-p") && i + 1 < argc) o.tracks = atoi(argv[++i]);
+        else if (argv[i][0] != '-' && !o.path) o.path = argv[i];
+        else {
+            fprintf(stderr, "usage: trajectory_stats file [-c coreRadius] [-p tracks]\n");
+            return 2;
+        }
+    }
+    if (!o.path) {
+        fprintf(stderr, "usage: trajectory_stats file [-c coreRadius] [-p tracks]\n");
+        return 2;
+    }
+
+    TrajectoryReader in;
+    if (!in.open(o.path)) return 1;
+    const TrajectoryHeader& h = in.info();
+    const int frames = in.frameCount();
+    const float r2 = o.coreRadius * o.coreRadius;
+    printf("%d particles, %d frames every %u steps (%.3f s), %s\n", in.particleCount(), frames,
+           h.stepsPerFrame, h.stepsPerFrame * h.dt, (h.flags & TRAJECTORY_FLOAT16) ? "float16" : "float32");
+
+    // Timesteps: share of particles in the core, mean vertical speed inside
+    // and outside it
+    double coreShare = 0.0, coreVy = 0.0, outerVy = 0.0;
+    long coreSamples = 0, outerSamples = 0;
+    TrajectoryReader::Frame f;
+    for (int k = 0; k < frames; k++) {
+        in.readFrame(k, f);
+        int inCore = 0;
+        for (int i = 0; i < in.particleCount(); i++) {
+            if (f.px[i] * f.px[i] + f.pz[i] * f.pz[i] < r2) {
+                inCore++;
+                coreVy += f.vy[i];
+            } else {
+                outerVy += f.vy[i];
+            }
+        }
+        coreShare += (double)inCore / in.particleCount();
+        coreSamples += inCore;
+        outerSamples += in.particleCount() - inCore;
+    }
+    printf("frames: %.1f%% of particles in the core, vertical speed %.2f in the core, %.2f outside\n",
+           100.0 * coreShare / std::max(frames, 1), coreVy / std::max(coreSamples, 1L),
+           outerVy / std::max(outerSamples, 1L));
+
+    // Tracks: time in the core per visit and overall, and net vertical
+    // travel with wraps through the box undone
+    const float height = h.boxMax[1] - h.boxMin[1];
+    const int tracks = std::min(o.tracks, in.particleCount());
+    double dwell = 0.0, rise = 0.0, riseSq = 0.0, span = 0.0;
+    long visits = 0;
+    std::vector<TrajectoryReader::TrackPoint> track;
+    for (int t = 0; t < tracks; t++) {
+        int i = (int)((long)t * in.particleCount() / tracks);
+        in.readTrack(i, track);
+        if (track.size() < 2) continue;
+
+        bool wasIn = false;
+        double dy = 0.0;
+        for (size_t k = 0; k < track.size(); k++) {
+            Vector3 p = track[k].position;
+            bool inside = p.x * p.x + p.z * p.z < r2;
+            if (inside && !wasIn) visits++;
+            if (k > 0) {
+                float step = p.y - track[k - 1].position.y;
+                if (step > 0.5f * height) step -= height;
+                else if (step < -0.5f * height) step += height;
+                dy += step;
+                if (inside) dwell += track[k].time - track[k - 1].time;
+            }
+            wasIn = inside;
+        }
+        rise += dy;
+        riseSq += dy * dy;
+        span += track.back().time - track.front().time;
+    }
+    const double seconds = span / std::max(tracks, 1);
+    const double meanRise = rise / std::max(tracks, 1);
+    printf("tracks: %d over %.1f s, %.2f s in the core each (%.2f s per visit)\n",
+           tracks, seconds, dwell / std::max(tracks, 1), dwell / std::max(visits, 1L));
+    printf("        vertical travel %.1f mean, %.1f rms (%.2f units/s)\n",
+           meanRise, std::sqrt(riseSq / std::max(tracks, 1)), meanRise / std::max(seconds, 1e-6));
+    return 0;
+}
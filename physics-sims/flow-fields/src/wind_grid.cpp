@@ -0,0 +1,169 @@
+#include "wind_grid.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// ---- helpers ----
+static inline float LerpF(float a, float b, float t) {
+    return a + t * (b - a);
+}
+
+// Grid coordinate of p along one axis: node index i and fraction f, with
+// points outside the box held on its faces
+static inline void Locate(float p, float lo, float inv, int n, int& i, float& f) {
+    float g = std::min(std::max((p - lo) * inv, 0.0f), (float)(n - 1));
+    i = std::min((int)g, n - 2);
+    f = g - (float)i;
+}
+
+// Sample positions and winds of one row of nodes, kept per thread so a
+// bake allocates nothing once every thread has seen a row
+struct BakeScratch {
+    std::vector<float> x, y, z, wx, wy, wz;
+
+    void resize(int n) {
+        for (std::vector<float>* v : { &x, &y, &z, &wx, &wy, &wz }) v->resize(n);
+    }
+};
+
+static thread_local BakeScratch scratch;
+
+// ---- WindGrid ----
+void WindGrid::init(BoundingBox b, int x, int y, int z, float keyInterval) {
+    box = b;
+    nx = std::max(x, 2);
+    ny = std::max(y, 2);
+    nz = std::max(z, 2);
+    cell = { (b.max.x - b.min.x) / (nx - 1), (b.max.y - b.min.y) / (ny - 1), (b.max.z - b.min.z) / (nz - 1) };
+    invCell = { 1.0f / cell.x, 1.0f / cell.y, 1.0f / cell.z };
+    interval = keyInterval;
+
+    const Node zero = { 0, 0, 0, 0 };
+    for (Nodes* f : { &keyA, &keyB, &next, &current }) f->assign((size_t)nodeCount(), zero);
+    started = false;
+}
+
+void WindGrid::bake(Nodes& f, const wind::SampleFn& field, float t, int z0, int z1, ThreadPool* pool) {
+    // One task per row of nodes, sampled as one batch
+    const int rows = (z1 - z0) * ny;
+    auto bakeRow = [&](int r) {
+        const int k = z0 + r / ny, j = r % ny;
+        BakeScratch& w = scratch;
+        w.resize(nx);
+        for (int i = 0; i < nx; ++i) w.x[i] = box.min.x + i * cell.x;
+        std::fill(w.y.begin(), w.y.end(), box.min.y + j * cell.y);
+        std::fill(w.z.begin(), w.z.end(), box.min.z + k * cell.z);
+        field(w.x.data(), w.y.data(), w.z.data(), nx, t, w.wx.data(), w.wy.data(), w.wz.data());
+
+        Node* row = &f[((size_t)k * ny + j) * nx];
+        for (int i = 0; i < nx; ++i) row[i] = { w.wx[i], w.wy[i], w.wz[i], 0.0f };
+    };
+    if (pool) pool->parallelFor(rows, bakeRow);
+    else for (int r = 0; r < rows; ++r) bakeRow(r);
+}
+
+void WindGrid::advance(const wind::SampleFn& field, float t, ThreadPool* pool) {
+    // Further ahead than the keyframe being baked: start over at t
+    if (started && t >= tA + 2.0f * interval) started = false;
+    if (!started) {
+        tA = t;
+        bake(keyA, field, tA, 0, nz, pool);
+        bake(keyB, field, tA + interval, 0, nz, pool);
+        nextSlices = 0;
+        started = true;
+    }
+
+    // Roll the keyframes forward, finishing `next` first if the frame
+    // skipped past the time it was paced for
+    if (t >= tA + interval) {
+        bake(next, field, tA + 2.0f * interval, nextSlices, nz, pool);
+        std::swap(keyA, keyB);
+        std::swap(keyB, next);
+        tA += interval;
+        nextSlices = 0;
+    }
+
+    // Bake next in step with the time spent in the current interval
+    const float s = (t - tA) / interval;
+    const int due = std::min(nz, (int)std::ceil(s * nz));
+    if (due > nextSlices) {
+        bake(next, field, tA + 2.0f * interval, nextSlices, due, pool);
+        nextSlices = due;
+    }
+
+    // Blend the current pair, one task per z slice
+    const size_t slice = (size_t)nx * ny;
+    auto blend = [&](int k) {
+        const Node* a = &keyA[k * slice];
+        const Node* b = &keyB[k * slice];
+        Node* c = &current[k * slice];
+        for (size_t i = 0; i < slice; ++i) {
+            c[i] = { LerpF(a[i].x, b[i].x, s), LerpF(a[i].y, b[i].y, s), LerpF(a[i].z, b[i].z, s), 0.0f };
+        }
+    };
+    if (pool) pool->parallelFor(nz, blend);
+    else for (int k = 0; k < nz; ++k) blend(k);
+    now = t;
+}
+
+Vector3 WindGrid::operator()(Vector3 p, float t) const {
+    Vector3 w = { 0, 0, 0 };
+    addBatch(&p.x, &p.y, &p.z, 1, t, &w.x, &w.y, &w.z);
+    return w;
+}
+
+void WindGrid::addBatch(const float* x, const float* y, const float* z, int count,
+                        float, float* fx, float* fy, float* fz) const {
+    const size_t sy = (size_t)nx, sz = (size_t)nx * ny;
+    for (int n = 0; n < count; ++n) {
+        int i, j, k;
+        float u, v, w;
+        Locate(x[n], box.min.x, invCell.x, nx, i, u);
+        Locate(y[n], box.min.y, invCell.y, ny, j, v);
+        Locate(z[n], box.min.z, invCell.z, nz, k, w);
+
+        const Node* c = &current[k * sz + j * sy + i];
+        const Node& c000 = c[0],       & c100 = c[1];
+        const Node& c010 = c[sy],      & c110 = c[sy + 1];
+        const Node& c001 = c[sz],      & c101 = c[sz + 1];
+        const Node& c011 = c[sz + sy], & c111 = c[sz + sy + 1];
+
+        // Along x, then y, then z
+        float x00 = LerpF(c000.x, c100.x, u), x10 = LerpF(c010.x, c110.x, u);
+        float x01 = LerpF(c001.x, c101.x, u), x11 = LerpF(c011.x, c111.x, u);
+        float y00 = LerpF(c000.y, c100.y, u), y10 = LerpF(c010.y, c110.y, u);
+        float y01 = LerpF(c001.y, c101.y, u), y11 = LerpF(c011.y, c111.y, u);
+        float z00 = LerpF(c000.z, c100.z, u), z10 = LerpF(c010.z, c110.z, u);
+        float z01 = LerpF(c001.z, c101.z, u), z11 = LerpF(c011.z, c111.z, u);
+
+        fx[n] += LerpF(LerpF(x00, x10, v), LerpF(x01, x11, v), w);
+        fy[n] += LerpF(LerpF(y00, y10, v), LerpF(y01, y11, v), w);
+        fz[n] += LerpF(LerpF(z00, z10, v), LerpF(z01, z11, v), w);
+    }
+}
+
+float WindGrid::compare(const wind::SampleFn& field, int samples, float* maxError) const {
+    // Fixed low-discrepancy points (R3 sequence), so successive
+    // measurements compare like with like
+    const float a1 = 0.8191725134f, a2 = 0.6710436067f, a3 = 0.5497004779f;
+    double err2 = 0.0, ref2 = 0.0;
+    float worst = 0.0f;
+    for (int n = 0; n < samples; ++n) {
+        float fx = std::fmod(0.5f + a1 * n, 1.0f);
+        float fy = std::fmod(0.5f + a2 * n, 1.0f);
+        float fz = std::fmod(0.5f + a3 * n, 1.0f);
+        Vector3 p = { LerpF(box.min.x, box.max.x, fx), LerpF(box.min.y, box.max.y, fy), LerpF(box.min.z, box.max.z, fz) };
+
+        Vector3 exact;
+        field(&p.x, &p.y, &p.z, 1, now, &exact.x, &exact.y, &exact.z);
+        Vector3 baked = (*this)(p, now);
+        float dx = baked.x - exact.x, dy = baked.y - exact.y, dz = baked.z - exact.z;
+        float e2 = dx*dx + dy*dy + dz*dz;
+        err2 += e2;
+        ref2 += exact.x*exact.x + exact.y*exact.y + exact.z*exact.z;
+        worst = std::max(worst, std::sqrt(e2));
+    }
+    if (maxError) *maxError = worst;
+    return ref2 > 0.0 ? (float)std::sqrt(err2 / ref2) : 0.0f;
+}
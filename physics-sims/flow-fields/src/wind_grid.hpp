@@ -0,0 +1,72 @@
+#pragma once
+#include <raylib.h>
+#include <vector>
+#include "field.hpp"
+
+class ThreadPool;
+
+// Wind baked into a regular grid of nodes over a box and sampled with
+// trilinear interpolation: eight node loads and a few multiply-adds per
+// particle instead of the full wind function. The grid is itself a field
+// (field.hpp), so particles step through it like through any other.
+//
+// Time is handled with keyframes interval seconds apart. The field at t
+// is a blend of the two keyframes around it; that blend is written once
+// per update into the grid the particles read. While the current pair is
+// in use the next keyframe is baked a few z slices per update, paced so
+// it is complete when it is needed, so the wind function is evaluated
+// about nodeCount() times per interval instead of once per particle per
+// frame.
+class WindGrid {
+public:
+    void init(BoundingBox box, int nx, int ny, int nz, float interval);
+
+    // Moves the grid to time t (t must not go backwards): rolls keyframes,
+    // bakes this update's share of the next one and blends the current pair.
+    // A jump of more than one interval rebakes both keyframes at t.
+    template <typename F>
+    void update(const F& field, float t, ThreadPool* pool = nullptr) {
+        advance(wind::sampler(field), t, pool);
+    }
+    void invalidate() { started = false; }         // rebake both keyframes at the next update
+
+    // Compares the grid with field at the time of the last update over
+    // `samples` points spread through the box. Returns the RMS error
+    // relative to the RMS wind speed; maxError gets the largest absolute
+    // error if given.
+    template <typename F>
+    float error(const F& field, int samples, float* maxError = nullptr) const {
+        return compare(wind::sampler(field), samples, maxError);
+    }
+
+    // As a field: the wind at the time of the last update, whatever t is
+    static constexpr bool isField = true;
+    Vector3 operator()(Vector3 p, float t) const;
+    void addBatch(const float* x, const float* y, const float* z, int count,
+                  float t, float* fx, float* fy, float* fz) const;
+
+    int nodeCount() const { return nx * ny * nz; }
+    float time() const { return now; }
+
+private:
+    struct Node { float x, y, z, pad; };           // 16 bytes: one load per corner
+    using Nodes = std::vector<Node>;
+
+    BoundingBox box{};
+    int nx = 0, ny = 0, nz = 0;
+    Vector3 cell{};                                // node spacing
+    Vector3 invCell{};
+    float interval = 0.5f;
+
+    Nodes keyA, keyB;                              // keyframes at tA and tA + interval
+    Nodes next;                                    // keyframe at tA + 2 interval, being baked
+    Nodes current;                                 // blend at `now`, read when sampled
+    float tA = 0.0f;
+    float now = 0.0f;
+    int nextSlices = 0;                            // z slices of `next` already baked
+    bool started = false;
+
+    void advance(const wind::SampleFn& field, float t, ThreadPool* pool);
+    void bake(Nodes& f, const wind::SampleFn& field, float t, int z0, int z1, ThreadPool* pool);
+    float compare(const wind::SampleFn& field, int samples, float* maxError) const;
+};
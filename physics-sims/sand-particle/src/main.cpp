@@ -1,50 +1,104 @@
 #include "sand.hpp"
+#include "renderer.hpp"
+#include "rng.hpp"
+#include "world_file.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 
-int main() {
+const int SCREEN_WIDTH = 1200;
+const int SCREEN_HEIGHT = 600;
+const float PAN_SPEED = 600.0f;   // screen pixels per second
+const char* const SAVE_PATH = "world.snw";
+
+// Keeps the view from drifting more than half a screen past the world edge
+static void ClampView(View& view) {
+    float w = SCREEN_WIDTH / view.zoom, h = SCREEN_HEIGHT / view.zoom;
+    view.origin.x = std::min(std::max(view.origin.x, -w / 2), WorldWidth() - w / 2);
+    view.origin.y = std::min(std::max(view.origin.y, -h / 2), WorldHeight() - h / 2);
+}
+
+// usage: sand [world width] [world height]   (cells, default 2400 x 1200)
+int main(int argc, char** argv) {
     InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT,
                "Advanced Falling Sand - raylib");
     SetTargetFPS(60);
 
-    for (int x = 0; x < GRID_WIDTH; x++)
-        for (int y = 0; y < GRID_HEIGHT; y++)
-            grid[x][y] = AIR;
+    InitWorld(argc > 1 ? atoi(argv[1]) : 2400, argc > 2 ? atoi(argv[2]) : 1200);
+    InitSimulation(1234);  // same seed and brush strokes -> same world on any core count
+
+    GridRenderer renderer;
+    renderer.Load(SCREEN_WIDTH, SCREEN_HEIGHT);
 
-    Image screenImage = GenImageColor(SCREEN_WIDTH, SCREEN_HEIGHT, SKYBLUE);
-    Texture2D screenTexture = LoadTextureFromImage(screenImage);
+    // Start at the bottom-left of the world, where the sand ends up
+    View view;
+    view.origin = { 0.0f, (float)WorldHeight() - SCREEN_HEIGHT / view.zoom };
+    ClampView(view);
 
     CellType currentMaterial = SAND;
     int brushSize = 6;
     bool paused = false;
+    bool showChunks = false;
 
     while (!WindowShouldClose()) {
-        if (IsKeyPressed(KEY_ONE))   currentMaterial = SAND;
-        if (IsKeyPressed(KEY_TWO))   currentMaterial = WATER;
-        if (IsKeyPressed(KEY_THREE)) currentMaterial = STONE;
-        if (IsKeyPressed(KEY_FOUR))  currentMaterial = OIL;
-        if (IsKeyPressed(KEY_FIVE))  currentMaterial = FIRE;
+        // Number keys pick materials in table order, 0 for the tenth
+        for (int m = 1; m < MATERIAL_COUNT && m <= 10; m++) {
+            if (IsKeyPressed(KEY_ZERO + m % 10)) currentMaterial = (CellType)m;
+        }
         if (IsKeyPressed(KEY_SPACE)) paused = !paused;
+        if (IsKeyPressed(KEY_C))     showChunks = !showChunks;
+        if (IsKeyPressed(KEY_F5))    SaveWorld(SAVE_PATH);
+        if (IsKeyPressed(KEY_F9) && LoadWorld(SAVE_PATH)) {
+            renderer.Invalidate();
+            ClampView(view);
+        }
 
         if (IsKeyDown(KEY_LEFT))  brushSize = (brushSize > 1)  ? brushSize - 1 : 1;
         if (IsKeyDown(KEY_RIGHT)) brushSize = (brushSize < 20) ? brushSize + 1 : 20;
 
+        // Camera: WASD or middle drag to pan, wheel to zoom around the cursor
+        float pan = PAN_SPEED * GetFrameTime() / view.zoom;
+        if (IsKeyDown(KEY_A)) view.origin.x -= pan;
+        if (IsKeyDown(KEY_D)) view.origin.x += pan;
+        if (IsKeyDown(KEY_W)) view.origin.y -= pan;
+        if (IsKeyDown(KEY_S)) view.origin.y += pan;
+        if (IsMouseButtonDown(MOUSE_MIDDLE_BUTTON)) {
+            Vector2 delta = GetMouseDelta();
+            view.origin.x -= delta.x / view.zoom;
+            view.origin.y -= delta.y / view.zoom;
+        }
+        float wheel = GetMouseWheelMove();
+        if (wheel != 0.0f) {
+            Vector2 mouse = GetMousePosition();
+            Vector2 anchor = view.ScreenToWorld(mouse);
+            view.zoom = Clamp(wheel > 0 ? view.zoom * 2.0f : view.zoom * 0.5f, MIN_ZOOM, MAX_ZOOM);
+            view.origin = { anchor.x - mouse.x / view.zoom, anchor.y - mouse.y / view.zoom };
+        }
+        ClampView(view);
+
         if (IsMouseButtonDown(MOUSE_LEFT_BUTTON) ||
             IsMouseButtonDown(MOUSE_RIGHT_BUTTON)) {
 
-            Vector2 mouse = GetMousePosition();
-            int gx = mouse.x / CELL_SIZE;
-            int gy = mouse.y / CELL_SIZE;
+            Vector2 cell = view.ScreenToWorld(GetMousePosition());
+            int gx = (int)std::floor(cell.x);
+            int gy = (int)std::floor(cell.y);
 
             CellType type =
                 IsMouseButtonDown(MOUSE_LEFT_BUTTON) ? currentMaterial : AIR;
+            const MaterialDef& def = MATERIALS[type];
+
+            // Life and variant come from the simulation seed, tick and brush
+            // cell, so a replayed stroke paints the same cells
+            Rng rng;
+            rng.Seed(MixSeed(SimulationSeed() ^ MixSeed(SimulationTick() ^
+                     MixSeed((uint64_t)(uint32_t)gy << 32 | (uint32_t)gx))));
 
             for (int dx = -brushSize; dx <= brushSize; dx++) {
                 for (int dy = -brushSize; dy <= brushSize; dy++) {
-                    int nx = gx + dx, ny = gy + dy;
-                    if (nx >= 0 && nx < GRID_WIDTH &&
-                        ny >= 0 && ny < GRID_HEIGHT &&
-                        dx*dx + dy*dy <= brushSize*brushSize) {
-                        grid[nx][ny] = type;
-                        if (type == FIRE) fireLife[nx][ny] = 40;
+                    if (dx*dx + dy*dy <= brushSize*brushSize) {
+                        // SetCell ignores cells outside the world
+                        int life = def.life[0] + (int)rng.Below(def.life[1] - def.life[0] + 1);
+                        SetCell(gx + dx, gy + dy, MakeCell(type, life, type == AIR ? 0 : rng.Below(16)));
                     }
                 }
             }
@@ -52,18 +106,27 @@ int main() {
 
         if (!paused) UpdateSimulation();
 
-        DrawGrid(screenImage);
-        UpdateTexture(screenTexture, screenImage.data);
-
         BeginDrawing();
-        ClearBackground(SKYBLUE);
-        DrawTexture(screenTexture, 0, 0, WHITE);
+        ClearBackground(VOID_COLOR);
+        renderer.Draw(view, SCREEN_WIDTH, SCREEN_HEIGHT);
+        if (showChunks) {
+            renderer.DrawChunkOverlay(view, SCREEN_WIDTH, SCREEN_HEIGHT);
+            DrawText(TextFormat("active chunks: %i   allocated: %i / %i   threads: %i",
+                                ActiveChunkCount(), AllocatedChunkCount(),
+                                ChunksX() * ChunksY(), SimulationThreads()),
+                     10, 35, 20, WHITE);
+        }
+        Vector2 hover = view.ScreenToWorld(GetMousePosition());
+        DrawText(TextFormat("%s   %.0f C", MATERIALS[currentMaterial].name,
+                            GetTemperature((int)std::floor(hover.x), (int)std::floor(hover.y))),
+                 10, SCREEN_HEIGHT - 30, 20, WHITE);
+        if (SaveInProgress()) DrawText("saving...", SCREEN_WIDTH - 110, 10, 20, WHITE);
         DrawFPS(10, 10);
         EndDrawing();
     }
 
-    UnloadTexture(screenTexture);
-    UnloadImage(screenImage);
+    FinishSave();
+    renderer.Unload();
     CloseWindow();
     return 0;
 }
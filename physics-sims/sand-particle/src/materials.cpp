@@ -0,0 +1,117 @@
+#include "materials.hpp"
+#include <algorithm>
+
+// To add a material: give it a CellType, a row here, and any special
+// reactions below. Cell::material has room for 32.
+const MaterialDef MATERIALS[MATERIAL_COUNT] = {
+    // name     behaviour  dens  disp  move    flam  burnLife  life      decay   decaysTo ignites corrodes resist  colour range                                 flicker
+    { "Air",    EMPTY,     10,   0,    ALWAYS, 0,    {0, 0},   {0, 0},   0,      AIR,     false,  0,       ALWAYS, {50, 100, 150, 255}, {50, 100, 150, 255},    false },
+    { "Sand",   POWDER,    150,  0,    ALWAYS, 93,   {20, 40}, {0, 0},   0,      AIR,     false,  0,       140,    {212, 182, 92, 255}, {227, 197, 107, 255},  false },
+    { "Water",  LIQUID,    100,  1,    ALWAYS, 0,    {0, 0},   {0, 0},   0,      AIR,     false,  0,       ALWAYS, {42, 92, 212, 255}, {57, 107, 227, 255},    false },
+    { "Stone",  SOLID,     255,  0,    ALWAYS, 0,    {0, 0},   {0, 0},   0,      AIR,     false,  0,       200,    {92, 92, 92, 255}, {107, 107, 107, 255},    false },
+    { "Oil",    LIQUID,    80,   1,    ALWAYS, 93,   {20, 40}, {0, 0},   0,      AIR,     false,  0,       120,    {72, 42, 12, 255}, {87, 57, 27, 255},       false },
+    { "Fire",   RISING,    5,    0,    85,     0,    {0, 0},   {20, 40}, ALWAYS, AIR,     true,   0,       ALWAYS, {255, 130, 0, 255}, {255, 170, 0, 255},     true  },
+    { "Gas",    RISING,    3,    2,    ALWAYS, 220,  {3, 8},   {0, 0},   0,      AIR,     false,  0,       ALWAYS, {140, 170, 110, 255}, {165, 195, 135, 255}, false },
+    { "Acid",   LIQUID,    110,  2,    ALWAYS, 0,    {0, 0},   {0, 0},   0,      AIR,     false,  240,     ALWAYS, {90, 210, 40, 255}, {125, 245, 75, 255},    false },
+    { "Lava",   LIQUID,    200,  1,    48,     0,    {0, 0},   {0, 0},   0,      AIR,     false,  0,       ALWAYS, {215, 60, 10, 255}, {255, 120, 25, 255},    false },
+    { "Steam",  RISING,    4,    3,    ALWAYS, 0,    {0, 0},   {30, 63}, 40,     WATER,   false,  0,       ALWAYS, {185, 195, 210, 255}, {220, 225, 235, 255}, false },
+    { "Ice",    SOLID,     90,   0,    ALWAYS, 0,    {0, 0},   {0, 0},   0,      AIR,     false,  0,       160,    {170, 210, 235, 255}, {200, 230, 250, 255}, false },
+};
+
+// Heat. Lava cools into stone and boils the water it touches, oil and gas
+// ignite when heated, and fire holds itself at 600 degrees while it burns.
+// Air is open to the room around the world and drifts back to ambient, so
+// hot air clears and ice melts.
+const ThermalDef THERMAL[MATERIAL_COUNT] = {
+    //          cond  drift base  hot           becomes  cold          becomes
+    /* Air   */ { 1,  8,    20,   NO_THRESHOLD, AIR,     -NO_THRESHOLD, AIR   },
+    /* Sand  */ { 6,  0,    20,   NO_THRESHOLD, SAND,    -NO_THRESHOLD, SAND  },
+    /* Water */ { 18, 0,    20,   100,          STEAM,   0,             ICE   },
+    /* Stone */ { 10, 0,    20,   1100,         LAVA,    -NO_THRESHOLD, STONE },
+    /* Oil   */ { 4,  0,    20,   250,          FIRE,    -NO_THRESHOLD, OIL   },
+    /* Fire  */ { 8,  0,    600,  NO_THRESHOLD, FIRE,    600,           FIRE  },
+    /* Gas   */ { 2,  0,    20,   150,          FIRE,    -NO_THRESHOLD, GAS   },
+    /* Acid  */ { 12, 0,    20,   NO_THRESHOLD, ACID,    -NO_THRESHOLD, ACID  },
+    /* Lava  */ { 24, 0,    1200, NO_THRESHOLD, LAVA,    600,           STONE },
+    /* Steam */ { 3,  0,    110,  NO_THRESHOLD, STEAM,   80,            WATER },
+    /* Ice   */ { 18, 0,    -20,  1,            WATER,   -NO_THRESHOLD, ICE   },
+};
+
+// Reactions that do not follow from the columns above
+static const ReactionDef REACTIONS[] = {
+    { FIRE, WATER, 128,    AIR,   WATER },  // fire goes out
+};
+
+static bool Displaceable(const MaterialDef& m) {
+    return m.behaviour == EMPTY || m.behaviour == LIQUID || m.behaviour == RISING;
+}
+
+static MaterialTables CompileMaterials() {
+    MaterialTables t = {};
+
+    for (int a = 0; a < MATERIAL_COUNT; a++) {
+        const MaterialDef& m = MATERIALS[a];
+        MaterialProps& p = t.props[a];
+        p.direction = m.behaviour == POWDER || m.behaviour == LIQUID ? 1 : m.behaviour == RISING ? -1 : 0;
+        p.dispersion = (uint8_t)(m.behaviour == POWDER ? 0 : std::min(m.dispersion, MAX_DISPERSION));
+        p.moveChance = (uint16_t)m.moveChance;
+        p.decayChance = (uint16_t)(m.life[1] > 0 ? m.decayChance : 0);
+        p.decaysTo = (uint8_t)m.decaysTo;
+        p.lifeMin = (uint8_t)m.life[0];
+        p.lifeSpan = (uint8_t)(m.life[1] - m.life[0]);
+
+        const ThermalDef& th = THERMAL[a];
+        auto stored = [](int degrees) {
+            return (int16_t)std::min(std::max(degrees, -NO_THRESHOLD / TEMP_SCALE), NO_THRESHOLD / TEMP_SCALE) * TEMP_SCALE;
+        };
+        t.conductance[a] = (int16_t)(std::min(std::max(th.conductivity, 0), MAX_CONDUCTIVITY) << 9);
+        t.drift[a] = (int16_t)std::max(th.drift, 0);
+        t.baseTemp[a] = stored(th.baseTemp);
+        t.hotPoint[a] = th.hotPoint >= NO_THRESHOLD ? INT16_MAX : stored(th.hotPoint);
+        t.coldPoint[a] = th.coldPoint <= -NO_THRESHOLD ? INT16_MIN : stored(th.coldPoint);
+        t.hotBecomes[a] = (uint8_t)th.hotBecomes;
+        t.coldBecomes[a] = (uint8_t)th.coldBecomes;
+
+        for (int b = 0; b < MATERIAL_COUNT; b++) {
+            const MaterialDef& n = MATERIALS[b];
+            bool denser = p.direction > 0 ? m.density > n.density : m.density < n.density;
+            t.displaces[a][b] = p.direction != 0 && a != b && Displaceable(n) && denser;
+
+            Reaction& r = t.reactions[a][b];
+            if (m.ignites && n.flammability > 0) {
+                r.chance = (uint16_t)n.flammability;
+                r.self = (uint8_t)a;
+                r.other = FIRE;
+                r.lifeMin = (uint8_t)n.burnLife[0];
+                r.lifeSpan = (uint8_t)(n.burnLife[1] - n.burnLife[0]);
+            } else if (m.corrodes > 0 && b != AIR && b != a && m.corrodes > n.acidResistance) {
+                r.chance = (uint16_t)(m.corrodes - n.acidResistance);
+                r.self = AIR;
+                r.other = AIR;
+            }
+        }
+    }
+
+    for (const ReactionDef& d : REACTIONS) {
+        Reaction& r = t.reactions[d.a][d.b];
+        r.chance = (uint16_t)d.chance;
+        r.self = (uint8_t)d.aBecomes;
+        r.other = (uint8_t)d.bBecomes;
+    }
+
+    for (int a = 0; a < MATERIAL_COUNT; a++) {
+        for (int b = 0; b < MATERIAL_COUNT; b++) {
+            Reaction& r = t.reactions[a][b];
+            if (!r.chance) continue;
+            t.props[a].reactive = 1;
+            // Anything but a fire that caught starts with its material's usual life
+            if (r.other != FIRE || !MATERIALS[a].ignites) {
+                r.lifeMin = t.props[r.other].lifeMin;
+                r.lifeSpan = t.props[r.other].lifeSpan;
+            }
+        }
+    }
+    return t;
+}
+
+const MaterialTables MATERIAL_TABLES = CompileMaterials();
@@ -0,0 +1,111 @@
+#pragma once
+#include <cstdint>
+
+enum CellType {
+    AIR = 0, SAND = 1, WATER = 2, STONE = 3, OIL = 4, FIRE = 5,
+    GAS = 6, ACID = 7, LAVA = 8, STEAM = 9, ICE = 10,
+    MATERIAL_COUNT
+};
+
+enum Behaviour {
+    EMPTY,      // air: never updated, anything that moves can take its place
+    SOLID,      // never moves
+    POWDER,     // falls and piles up
+    LIQUID,     // falls and spreads sideways
+    RISING,     // gases and flames: a liquid upside down
+};
+
+// The simulation has no raylib dependency; the renderer converts
+struct Rgba {
+    uint8_t r, g, b, a;
+};
+
+// Probabilities are out of 256 per tick
+const int ALWAYS = 256;
+// Sideways reach per tick; a rule must stay within one chunk of its cell
+const int MAX_DISPERSION = 4;
+
+// How a material behaves, as written down. Nothing in the update reads
+// these directly: CompileMaterials turns them into the lookup tables below.
+struct MaterialDef {
+    const char* name;
+    Behaviour behaviour;
+    int density;            // heavier sinks through lighter liquids and gases
+    int dispersion;         // LIQUID, RISING: cells it can slide sideways
+    int moveChance;         // below ALWAYS for viscous materials
+    int flammability;       // chance per burning neighbour of catching fire
+    int burnLife[2];        // fire life when it catches
+    int life[2];            // life of a freshly placed cell, { 0, 0 }: none
+    int decayChance;        // chance of losing one life
+    CellType decaysTo;      // what is left when life runs out
+    bool ignites;           // sets flammable neighbours on fire
+    int corrodes;           // ACID: chance of eating a neighbour...
+    int acidResistance;     // ...reduced by this much
+    Rgba colorLo, colorHi;  // the cell's variant picks a shade in between
+    bool flicker;           // shade follows life, so it changes while burning
+};
+
+// Temperatures are stored per cell as int16 in 1/TEMP_SCALE degrees C
+const int TEMP_SCALE = 8;
+const int AMBIENT_TEMP = 20;
+const int MAX_CONDUCTIVITY = 24;   // keeps the explicit diffusion step stable
+const int NO_THRESHOLD = 30000;    // degrees C, never reached
+
+// How a material takes and gives off heat. Above hotPoint it turns into
+// hotBecomes, below coldPoint into coldBecomes. A material that turns
+// into itself below coldPoint is a heat source held at that temperature.
+struct ThermalDef {
+    int conductivity;       // 0 .. MAX_CONDUCTIVITY, the slower of two neighbours sets the flow
+    int drift;              // 1/TEMP_SCALE degrees per heat step back towards ambient
+    int baseTemp;           // temperature of a freshly placed cell
+    int hotPoint;
+    CellType hotBecomes;
+    int coldPoint;
+    CellType coldBecomes;
+};
+
+// Two neighbouring materials that turn into something else
+struct ReactionDef {
+    CellType a, b;
+    int chance;
+    CellType aBecomes, bBecomes;
+};
+
+extern const MaterialDef MATERIALS[MATERIAL_COUNT];
+extern const ThermalDef THERMAL[MATERIAL_COUNT];
+
+// Per-material data read by the update, packed for the hot loop
+struct MaterialProps {
+    int8_t direction;       // +1 falls, -1 rises, 0 stays put
+    uint8_t dispersion;
+    uint16_t moveChance;
+    uint16_t decayChance;
+    uint8_t decaysTo;
+    uint8_t lifeMin, lifeSpan;  // life of a new cell of this material
+    uint8_t reactive;       // has at least one entry in its reactions row
+};
+
+struct Reaction {
+    uint16_t chance = 0;    // 0: nothing happens
+    uint8_t self = AIR, other = AIR;
+    uint8_t lifeMin = 0, lifeSpan = 0;  // life given to `other`
+};
+
+struct MaterialTables {
+    MaterialProps props[MATERIAL_COUNT];
+    // displaces[a][b]: a moving in its direction may swap places with b
+    uint8_t displaces[MATERIAL_COUNT][MATERIAL_COUNT];
+    // reactions[a][b]: what a does to a neighbouring b each tick
+    Reaction reactions[MATERIAL_COUNT][MATERIAL_COUNT];
+
+    // Thermal columns in stored units (1/TEMP_SCALE degrees)
+    int16_t conductance[MATERIAL_COUNT];    // conductivity << 9, a multiplier for mulhi
+    int16_t drift[MATERIAL_COUNT];
+    int16_t baseTemp[MATERIAL_COUNT];
+    int16_t hotPoint[MATERIAL_COUNT];       // turns into hotBecomes at or above
+    int16_t coldPoint[MATERIAL_COUNT];      // turns into coldBecomes below
+    uint8_t hotBecomes[MATERIAL_COUNT];
+    uint8_t coldBecomes[MATERIAL_COUNT];
+};
+
+extern const MaterialTables MATERIAL_TABLES;
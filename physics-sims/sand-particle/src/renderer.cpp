@@ -0,0 +1,169 @@
+#include "renderer.hpp"
+#include <algorithm>
+#include <cmath>
+
+// 16 shades per material, one per cell variant, from the material table
+struct ShadeTable {
+    Color shades[MATERIAL_COUNT][16];
+
+    ShadeTable() {
+        for (int m = 0; m < MATERIAL_COUNT; m++) {
+            Rgba lo = MATERIALS[m].colorLo, hi = MATERIALS[m].colorHi;
+            for (int k = 0; k < 16; k++) {
+                shades[m][k] = { (unsigned char)(lo.r + (hi.r - lo.r) * k / 15),
+                                 (unsigned char)(lo.g + (hi.g - lo.g) * k / 15),
+                                 (unsigned char)(lo.b + (hi.b - lo.b) * k / 15),
+                                 (unsigned char)(lo.a + (hi.a - lo.a) * k / 15) };
+            }
+        }
+    }
+};
+
+static const ShadeTable shadeTable;
+
+static Color CellColor(Cell c) {
+    // Flickering materials pick the shade from life as well: life drops
+    // every tick, so the colour keeps changing without a random draw
+    int k = MATERIALS[c.material].flicker ? (c.variant * 7 + c.life * 13) & 15 : c.variant;
+    return shadeTable.shades[c.material][k];
+}
+
+// Chunk range [first, last] covering the screen span starting at world cell origin
+static void VisibleChunks(float origin, int screenSize, float zoom, int chunkCount, int& first, int& last) {
+    first = std::max((int)std::floor(origin) >> CHUNK_SHIFT, 0);
+    last = std::min((int)std::floor(origin + screenSize / zoom) >> CHUNK_SHIFT, chunkCount - 1);
+}
+
+void GridRenderer::Load(int screenWidth, int screenHeight) {
+    // A view spans at most screen / MIN_ZOOM cells, which can straddle one
+    // more chunk than it covers
+    capacityX = (int)std::ceil(screenWidth / (MIN_ZOOM * CHUNK_SIZE)) + 1;
+    capacityY = (int)std::ceil(screenHeight / (MIN_ZOOM * CHUNK_SIZE)) + 1;
+    image = GenImageColor(capacityX * CHUNK_SIZE, capacityY * CHUNK_SIZE, VOID_COLOR);
+    texture = LoadTextureFromImage(image);
+    painted = false;
+}
+
+void GridRenderer::Unload() {
+    UnloadTexture(texture);
+    UnloadImage(image);
+}
+
+// Paints world cells minX..maxX, minY..maxY, which must lie in the texture
+void GridRenderer::PaintRect(int minX, int minY, int maxX, int maxY) {
+    Color* pixels = (Color*)image.data;
+    const int originX = paintedX * CHUNK_SIZE, originY = paintedY * CHUNK_SIZE;
+
+    for (int y = minY; y <= maxY; y++) {
+        Color* row = pixels + (y - originY) * image.width - originX;
+        for (int x = minX; x <= maxX; x++) row[x] = CellColor(GetCell(x, y));
+    }
+}
+
+void GridRenderer::Repaint(int firstX, int firstY) {
+    paintedX = firstX;
+    paintedY = firstY;
+    painted = true;
+
+    Color* pixels = (Color*)image.data;
+    std::fill(pixels, pixels + image.width * image.height, VOID_COLOR);
+
+    const int lastX = std::min(firstX + capacityX, ChunksX()) - 1;
+    const int lastY = std::min(firstY + capacityY, ChunksY()) - 1;
+    for (int cy = firstY; cy <= lastY; cy++) {
+        for (int cx = firstX; cx <= lastX; cx++) {
+            // Unallocated chunks are all air; one colour, no lookups
+            Chunk* c = GetChunk(cx, cy);
+            int x0 = cx * CHUNK_SIZE, x1 = std::min(x0 + CHUNK_SIZE, WorldWidth()) - 1;
+            int y0 = cy * CHUNK_SIZE, y1 = std::min(y0 + CHUNK_SIZE, WorldHeight()) - 1;
+            if (c) {
+                PaintRect(x0, y0, x1, y1);
+                c->redraw = DirtyRect();
+            } else {
+                for (int y = y0; y <= y1; y++) {
+                    Color* row = pixels + (y - firstY * CHUNK_SIZE) * image.width - firstX * CHUNK_SIZE;
+                    std::fill(row + x0, row + x1 + 1, shadeTable.shades[AIR][0]);
+                }
+            }
+        }
+    }
+    UpdateTexture(texture, pixels);
+}
+
+void GridRenderer::Draw(const View& view, int screenWidth, int screenHeight) {
+    int firstX, lastX, firstY, lastY;
+    VisibleChunks(view.origin.x, screenWidth, view.zoom, ChunksX(), firstX, lastX);
+    VisibleChunks(view.origin.y, screenHeight, view.zoom, ChunksY(), firstY, lastY);
+
+    if (!painted || firstX < paintedX || firstY < paintedY ||
+        lastX >= paintedX + capacityX || lastY >= paintedY + capacityY) {
+        // Centre the texture on the view so small pans stay inside it
+        int spareX = capacityX - (lastX - firstX + 1), spareY = capacityY - (lastY - firstY + 1);
+        Repaint(std::max(firstX - spareX / 2, 0), std::max(firstY - spareY / 2, 0));
+    } else {
+        const int lastPaintedX = std::min(paintedX + capacityX, ChunksX()) - 1;
+        const int lastPaintedY = std::min(paintedY + capacityY, ChunksY()) - 1;
+        Color* pixels = (Color*)image.data;
+
+        for (int cy = paintedY; cy <= lastPaintedY; cy++) {
+            // Rows touched by any chunk in this band are uploaded as one block
+            int bandMin = INT_MAX, bandMax = -1;
+
+            for (int cx = paintedX; cx <= lastPaintedX; cx++) {
+                Chunk* c = GetChunk(cx, cy);
+                if (!c || c->redraw.Empty()) continue;
+
+                const DirtyRect& r = c->redraw;
+                PaintRect(r.minX, r.minY, r.maxX, r.maxY);
+                bandMin = std::min(bandMin, r.minY);
+                bandMax = std::max(bandMax, r.maxY);
+                c->redraw = DirtyRect();
+            }
+
+            if (bandMax >= bandMin) {
+                int top = bandMin - paintedY * CHUNK_SIZE;
+                Rectangle rows = { 0.0f, (float)top, (float)image.width, (float)(bandMax - bandMin + 1) };
+                UpdateTextureRec(texture, rows, pixels + top * image.width);
+            }
+        }
+    }
+
+    // Draw only the part of the texture inside the world; the rest of the
+    // screen keeps the clear colour
+    float x0 = std::max(view.origin.x, 0.0f), y0 = std::max(view.origin.y, 0.0f);
+    float x1 = std::min(view.origin.x + screenWidth / view.zoom, (float)WorldWidth());
+    float y1 = std::min(view.origin.y + screenHeight / view.zoom, (float)WorldHeight());
+    if (x1 <= x0 || y1 <= y0) return;
+
+    Rectangle source = { x0 - paintedX * CHUNK_SIZE, y0 - paintedY * CHUNK_SIZE, x1 - x0, y1 - y0 };
+    Rectangle dest = { (x0 - view.origin.x) * view.zoom, (y0 - view.origin.y) * view.zoom,
+                       (x1 - x0) * view.zoom, (y1 - y0) * view.zoom };
+    DrawTexturePro(texture, source, dest, { 0, 0 }, 0.0f, WHITE);
+}
+
+void GridRenderer::DrawChunkOverlay(const View& view, int screenWidth, int screenHeight) const {
+    int firstX, lastX, firstY, lastY;
+    VisibleChunks(view.origin.x, screenWidth, view.zoom, ChunksX(), firstX, lastX);
+    VisibleChunks(view.origin.y, screenHeight, view.zoom, ChunksY(), firstY, lastY);
+
+    auto outline = [&](int x, int y, int w, int h, Color color) {
+        DrawRectangleLines((int)std::floor((x - view.origin.x) * view.zoom),
+                           (int)std::floor((y - view.origin.y) * view.zoom),
+                           (int)std::ceil(w * view.zoom), (int)std::ceil(h * view.zoom), color);
+    };
+
+    for (int cy = firstY; cy <= lastY; cy++) {
+        for (int cx = firstX; cx <= lastX; cx++) {
+            const Chunk* c = GetChunk(cx, cy);
+            if (!c) continue;
+
+            if (c->current.Empty()) {
+                outline(cx * CHUNK_SIZE, cy * CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE, Fade(GRAY, 0.4f));
+                continue;
+            }
+            const DirtyRect& r = c->current;
+            outline(cx * CHUNK_SIZE, cy * CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE, GREEN);
+            outline(r.minX, r.minY, r.maxX - r.minX + 1, r.maxY - r.minY + 1, RED);
+        }
+    }
+}
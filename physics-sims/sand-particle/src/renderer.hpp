@@ -0,0 +1,44 @@
+#pragma once
+#include <raylib.h>
+#include <raymath.h>
+#include "sand.hpp"
+
+const int CELL_SIZE = 4;       // default zoom, screen pixels per cell
+const float MIN_ZOOM = 1.0f;
+const float MAX_ZOOM = 16.0f;
+const Color VOID_COLOR = {20, 20, 28, 255};   // outside the world
+
+// The part of the world on screen: origin is the world cell at the top-left
+// corner, zoom is screen pixels per cell
+struct View {
+    Vector2 origin = { 0.0f, 0.0f };
+    float zoom = CELL_SIZE;
+
+    Vector2 ScreenToWorld(Vector2 p) const { return { origin.x + p.x / zoom, origin.y + p.y / zoom }; }
+};
+
+// Draws the world through a texture that holds only the chunks around the
+// view, one pixel per cell. The texture is sized for the most zoomed-out
+// view, so the world itself can be any size. While the view stays inside
+// the painted chunks only their redraw rectangles are repainted and the
+// changed rows uploaded; moving past them repaints around the new view.
+class GridRenderer {
+private:
+    Image image = {};
+    Texture2D texture = {};
+    int capacityX = 0, capacityY = 0;   // texture size in chunks
+    int paintedX = 0, paintedY = 0;     // first chunk held by the texture
+    bool painted = false;
+
+    void Repaint(int firstX, int firstY);
+    void PaintRect(int minX, int minY, int maxX, int maxY);
+
+public:
+    void Load(int screenWidth, int screenHeight);
+    void Unload();
+
+    void Invalidate() { painted = false; }   // repaint everything, e.g. after loading a world
+    void Draw(const View& view, int screenWidth, int screenHeight);
+    // Outlines active chunks in view and their dirty rectangles
+    void DrawChunkOverlay(const View& view, int screenWidth, int screenHeight) const;
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+
+// SplitMix64 finaliser: turns related inputs (seed, tick, chunk or cell)
+// into unrelated generator seeds
+inline uint64_t MixSeed(uint64_t z) {
+    z += 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// xorshift64* generator for the cell rules: a few instructions per draw and
+// no shared state, so every update context owns one.
+// Coin flips come out of a 64-bit reservoir, one full draw per 64 flips.
+struct Rng {
+    uint64_t state = 0x9e3779b97f4a7c15ull;
+    uint64_t bits = 0;
+    int bitsLeft = 0;
+
+    void Seed(uint64_t seed) {
+        state = seed ? seed : 0x9e3779b97f4a7c15ull;   // zero would stay zero
+        bitsLeft = 0;
+    }
+
+    uint64_t Next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545f4914f6cdd1dull;
+    }
+
+    bool Coin() {
+        if (bitsLeft == 0) {
+            bits = Next();
+            bitsLeft = 64;
+        }
+        bool b = bits & 1;
+        bits >>= 1;
+        bitsLeft--;
+        return b;
+    }
+
+    // Uniform in [0, n) by multiply-shift; no division in the hot loop
+    uint32_t Below(uint32_t n) {
+        return (uint32_t)(((Next() >> 32) * n) >> 32);
+    }
+
+    // True with probability num / den
+    bool Chance(uint32_t num, uint32_t den) {
+        return Below(den) < num;
+    }
+};
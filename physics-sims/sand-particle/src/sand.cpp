@@ -1,125 +1,764 @@
 #include "sand.hpp"
+#include "rng.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include <utility> // std::swap
+#include <vector>
 
-CellType grid[GRID_WIDTH][GRID_HEIGHT];
-int fireLife[GRID_WIDTH][GRID_HEIGHT] = {0};
+// A chunk can only safely update alongside the chunks of its phase if its
+// cell rules stay within half a chunk of the cell
+static_assert(MAX_DISPERSION + 1 < CHUNK_SIZE / 2, "cell rules reach too far for the checkerboard");
 
+// Chunks that stay all air, asleep and cold this many ticks go back to the
+// pool; warmth left in settled air goes with them
+static const int RELEASE_TICKS = 60;
 
-// Update the simulation state
-void UpdateSimulation() {
-    for (int y = GRID_HEIGHT - 2; y >= 0; y--) {
-        int startX = (y % 2 == 0) ? 0 : GRID_WIDTH - 1;
-        int endX   = (y % 2 == 0) ? GRID_WIDTH : -1;
-        int stepX  = (y % 2 == 0) ? 1 : -1;
-        // Randomize left-right scan each row for less bias
-        for (int x = startX; x != endX; x += stepX) {
-            CellType c = grid[x][y];
-            if (c == AIR) continue;
-
-            if (c == SAND || c == OIL) {
-                if (grid[x][y + 1] == AIR) {
-                    grid[x][y + 1] = c;
-                    grid[x][y] = AIR;
-                    continue;
-                }
+static const int16_t AMBIENT = AMBIENT_TEMP * TEMP_SCALE;
 
-                int dir = GetRandomValue(0, 1) ? -1 : 1;
-                int nx = x + dir;
-
-                if (nx >= 0 && nx < GRID_WIDTH && grid[nx][y + 1] == AIR) {
-                    grid[nx][y + 1] = c;
-                    grid[x][y] = AIR;
-                } else {
-                    nx = x - dir;
-                    if (nx >= 0 && nx < GRID_WIDTH && grid[nx][y + 1] == AIR) {
-                        grid[nx][y + 1] = c;
-                        grid[x][y] = AIR;
-                    }
-                }
+// Warm chunks take a heat step every HEAT_INTERVAL ticks, staggered by
+// chunk so each tick carries the same share. A step that moves no cell by
+// SETTLE_STEP or more lets the chunk go cold; the last fraction of a
+// degree stays where it is.
+static const int HEAT_INTERVAL = 2;
+static const int SETTLE_STEP = TEMP_SCALE / 4;
+
+// Fixed-size allocator for chunks. Chunks are carved out of slabs and
+// recycled through a free list, so sand flowing into new areas stops
+// hitting the heap once the pool has grown to the working set.
+class ChunkPool {
+private:
+    static const int SLAB_SIZE = 64;
+    std::vector<std::unique_ptr<Chunk[]>> slabs;
+    std::vector<Chunk*> freeList;
+
+public:
+    Chunk* Allocate(int cx, int cy) {
+        if (freeList.empty()) {
+            slabs.emplace_back(new Chunk[SLAB_SIZE]);
+            for (int i = SLAB_SIZE - 1; i >= 0; i--) freeList.push_back(&slabs.back()[i]);
+        }
+        Chunk* c = freeList.back();
+        freeList.pop_back();
+
+        *c = Chunk();
+        c->cx = cx;
+        c->cy = cy;
+        std::fill(std::begin(c->cells), std::end(c->cells), MakeCell(AIR));
+        std::fill(std::begin(c->temp), std::end(c->temp), AMBIENT);
+        return c;
+    }
+
+    void Release(Chunk* c) {
+        freeList.push_back(c);
+    }
+
+    void Clear() {
+        slabs.clear();
+        freeList.clear();
+    }
+};
+
+static int worldWidth = 0;
+static int worldHeight = 0;
+static int chunksX = 0;
+static int chunksY = 0;
+static std::vector<Chunk*> chunkTable;  // chunksX * chunksY, nullptr where all air
+static std::vector<Chunk*> live;        // every allocated chunk, in no particular order
+static ChunkPool chunkPool;
+static PreserveHook preserveHook = nullptr;
+
+void SetPreserveHook(PreserveHook hook) {
+    preserveHook = hook;
+}
+
+static void BeforeWrite(Chunk& c) {
+    if (c.snapshotSlot >= 0 && preserveHook) preserveHook(c);
+}
+
+void InitWorld(int width, int height) {
+    for (Chunk* c : live) {
+        BeforeWrite(*c);
+        chunkPool.Release(c);
+    }
+    live.clear();
+    chunkPool.Clear();
+
+    worldWidth = std::min(std::max(width, 1), MAX_WORLD_SIZE);
+    worldHeight = std::min(std::max(height, 1), MAX_WORLD_SIZE);
+    chunksX = (worldWidth + CHUNK_SIZE - 1) >> CHUNK_SHIFT;
+    chunksY = (worldHeight + CHUNK_SIZE - 1) >> CHUNK_SHIFT;
+    chunkTable.assign((size_t)chunksX * chunksY, nullptr);
+}
+
+int WorldWidth() { return worldWidth; }
+int WorldHeight() { return worldHeight; }
+int ChunksX() { return chunksX; }
+int ChunksY() { return chunksY; }
+
+Chunk* GetChunk(int cx, int cy) {
+    if (cx < 0 || cy < 0 || cx >= chunksX || cy >= chunksY) return nullptr;
+    return chunkTable[cy * chunksX + cx];
+}
+
+Chunk* EnsureChunk(int cx, int cy) {
+    Chunk*& c = chunkTable[cy * chunksX + cx];
+    if (!c) {
+        c = chunkPool.Allocate(cx, cy);
+        live.push_back(c);
+    }
+    BeforeWrite(*c);
+    return c;
+}
+
+// Only valid where the chunk is allocated; the update allocates every
+// neighbour of an awake chunk before it starts
+static Cell& CellAt(int x, int y) {
+    Chunk* c = chunkTable[(y >> CHUNK_SHIFT) * chunksX + (x >> CHUNK_SHIFT)];
+    return c->cells[((y & CHUNK_MASK) << CHUNK_SHIFT) | (x & CHUNK_MASK)];
+}
+
+static int16_t& TempAt(int x, int y) {
+    Chunk* c = chunkTable[(y >> CHUNK_SHIFT) * chunksX + (x >> CHUNK_SHIFT)];
+    return c->temp[((y & CHUNK_MASK) << CHUNK_SHIFT) | (x & CHUNK_MASK)];
+}
+
+Cell GetCell(int x, int y) {
+    if (x < 0 || y < 0 || x >= worldWidth || y >= worldHeight) return MakeCell(AIR);
+    const Chunk* c = chunkTable[(y >> CHUNK_SHIFT) * chunksX + (x >> CHUNK_SHIFT)];
+    return c ? c->cells[((y & CHUNK_MASK) << CHUNK_SHIFT) | (x & CHUNK_MASK)] : MakeCell(AIR);
+}
+
+void SetCell(int x, int y, Cell cell) {
+    if (x < 0 || y < 0 || x >= worldWidth || y >= worldHeight) return;
+    if (cell.material == AIR && !GetChunk(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT)) return;
+
+    Chunk* c = EnsureChunk(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT);
+    int i = ((y & CHUNK_MASK) << CHUNK_SHIFT) | (x & CHUNK_MASK);
+    int16_t base = MATERIAL_TABLES.baseTemp[cell.material];
+    if (c->temp[i] != base || base != AMBIENT) c->warmNext = true;
+    c->cells[i] = cell;
+    c->temp[i] = base;
+    WakeCell(x, y);
+}
+
+float GetTemperature(int x, int y) {
+    if (x < 0 || y < 0 || x >= worldWidth || y >= worldHeight) return (float)AMBIENT_TEMP;
+    const Chunk* c = chunkTable[(y >> CHUNK_SHIFT) * chunksX + (x >> CHUNK_SHIFT)];
+    if (!c) return (float)AMBIENT_TEMP;
+    return c->temp[((y & CHUNK_MASK) << CHUNK_SHIFT) | (x & CHUNK_MASK)] / (float)TEMP_SCALE;
+}
+
+static void Merge(DirtyRect& into, const DirtyRect& r) {
+    if (r.Empty()) return;
+    into.minX = std::min(into.minX, r.minX);
+    into.minY = std::min(into.minY, r.minY);
+    into.maxX = std::max(into.maxX, r.maxX);
+    into.maxY = std::max(into.maxY, r.maxY);
+}
+
+// Grow r to cover the cells x0..x1, y0..y1 that fall inside chunk (cx, cy)
+static void Expand(DirtyRect& r, int cx, int cy, int x0, int y0, int x1, int y1) {
+    r.minX = std::min(r.minX, std::max(x0, cx * CHUNK_SIZE));
+    r.maxX = std::max(r.maxX, std::min(x1, cx * CHUNK_SIZE + CHUNK_SIZE - 1));
+    r.minY = std::min(r.minY, std::max(y0, cy * CHUNK_SIZE));
+    r.maxY = std::max(r.maxY, std::min(y1, cy * CHUNK_SIZE + CHUNK_SIZE - 1));
+}
+
+// Per-chunk state for one tick of the parallel update. A chunk's cells can
+// wake cells in the 8 chunks around it; those wakes collect in an outbox
+// indexed by neighbour offset and are merged after the last phase, so no
+// two threads ever write the same rectangle. Heat flowing into a
+// neighbour marks it warm the same way.
+struct UpdateContext {
+    Chunk* chunk = nullptr;
+    int cx = 0, cy = 0;
+    Rng rng;
+    DirtyRect next[3][3];
+    DirtyRect redraw[3][3];
+    bool warm[3][3] = {};
+};
+
+static std::vector<UpdateContext> contexts;   // one per awake chunk this tick
+static std::unique_ptr<ThreadPool> pool;
+static uint64_t simulationSeed = 1;
+static uint64_t tickCount = 0;
+static uint64_t cellsScanned = 0;
+
+void InitSimulation(uint64_t seed, int threads) {
+    simulationSeed = seed;
+    tickCount = 0;
+    cellsScanned = 0;
+    pool.reset(new ThreadPool(threads));
+}
+
+uint64_t SimulationSeed() {
+    return simulationSeed;
+}
+
+uint64_t SimulationTick() {
+    return tickCount;
+}
+
+void ResumeSimulation(uint64_t seed, uint64_t tick) {
+    simulationSeed = seed;
+    tickCount = tick;
+}
+
+int SimulationThreads() {
+    return pool ? pool->Size() : 1;
+}
+
+// Wakes (x, y) and its neighbours. Inside the update ctx is the chunk being
+// processed and the wake lands in its outbox; outside it goes straight to
+// the chunks, skipping unallocated ones since all-air cells cannot change.
+static void Wake(UpdateContext* ctx, int x, int y) {
+    int x0 = std::max(x - 1, 0), x1 = std::min(x + 1, worldWidth - 1);
+    int y0 = std::max(y - 1, 0), y1 = std::min(y + 1, worldHeight - 1);
+
+    // The 3x3 neighbourhood can straddle up to four chunks
+    for (int cx = x0 >> CHUNK_SHIFT; cx <= x1 >> CHUNK_SHIFT; cx++) {
+        for (int cy = y0 >> CHUNK_SHIFT; cy <= y1 >> CHUNK_SHIFT; cy++) {
+            if (ctx) {
+                Expand(ctx->next[cx - ctx->cx + 1][cy - ctx->cy + 1], cx, cy, x0, y0, x1, y1);
+            } else if (Chunk* c = GetChunk(cx, cy)) {
+                Expand(c->next, cx, cy, x0, y0, x1, y1);
             }
-            else if (c == WATER) {
-                if (grid[x][y + 1] == AIR || grid[x][y + 1] == OIL) {
-                    std::swap(grid[x][y + 1], grid[x][y]);
-                    continue;
-                }
+        }
+    }
 
-                int dir = GetRandomValue(0, 1) ? -1 : 1;
-                int nx = x + dir;
-
-                if (nx >= 0 && nx < GRID_WIDTH &&
-                    (grid[nx][y + 1] == AIR || grid[nx][y + 1] == OIL)) {
-                    std::swap(grid[nx][y + 1], grid[x][y]);
-                } else {
-                    nx = x - dir;
-                    if (nx >= 0 && nx < GRID_WIDTH &&
-                        (grid[nx][y + 1] == AIR || grid[nx][y + 1] == OIL)) {
-                        std::swap(grid[nx][y + 1], grid[x][y]);
-                    } else {
-                        if (x + dir >= 0 && x + dir < GRID_WIDTH &&
-                            grid[x + dir][y] == AIR) {
-                            std::swap(grid[x + dir][y], grid[x][y]);
-                        }
-                    }
-                }
+    int cx = x >> CHUNK_SHIFT, cy = y >> CHUNK_SHIFT;
+    if (ctx) {
+        Expand(ctx->redraw[cx - ctx->cx + 1][cy - ctx->cy + 1], cx, cy, x, y, x, y);
+    } else if (Chunk* c = GetChunk(cx, cy)) {
+        Expand(c->redraw, cx, cy, x, y, x, y);
+    }
+}
+
+void WakeCell(int x, int y) {
+    Wake(nullptr, x, y);
+}
+
+// The chunk holding (x, y) diffuses heat next tick
+static void Heat(UpdateContext& ctx, int x, int y) {
+    ctx.warm[(x >> CHUNK_SHIFT) - ctx.cx + 1][(y >> CHUNK_SHIFT) - ctx.cy + 1] = true;
+}
+
+// The world's edges act as stone
+static CellType MaterialAt(int x, int y) {
+    if (x < 0 || y < 0 || x >= worldWidth || y >= worldHeight) return STONE;
+    return (CellType)CellAt(x, y).material;
+}
+
+// Both cells of a move are done for this tick
+static void Move(UpdateContext& ctx, int x, int y, int nx, int ny) {
+    Cell& a = CellAt(x, y);
+    Cell& b = CellAt(nx, ny);
+    std::swap(a, b);
+    a.updated = 1;
+    b.updated = 1;
+    Wake(&ctx, x, y);
+    Wake(&ctx, nx, ny);
+
+    // Heat moves with the material
+    int16_t& ta = TempAt(x, y);
+    int16_t& tb = TempAt(nx, ny);
+    if (ta != tb) {
+        std::swap(ta, tb);
+        Heat(ctx, x, y);
+        Heat(ctx, nx, ny);
+    }
+}
+
+static bool Roll(Rng& rng, int chance) {
+    return chance >= ALWAYS || rng.Chance(chance, ALWAYS);
+}
+
+// The cell keeps its temperature, clamped to the new material's range: a
+// degree below its hot point, so steam that condenses is water just below
+// boiling rather than water that boils straight back, and no colder than
+// its cold point, so a heat source starts out at least as hot as it is held.
+static void Transform(UpdateContext& ctx, int x, int y, int material, int lifeMin, int lifeSpan) {
+    const MaterialTables& tables = MATERIAL_TABLES;
+    Cell& cell = CellAt(x, y);
+    int variant = material == AIR ? 0 : cell.variant;   // air carries no variant
+    cell = MakeCell((CellType)material, lifeMin + (lifeSpan ? ctx.rng.Below(lifeSpan + 1) : 0), variant);
+    cell.updated = 1;
+
+    int16_t& t = TempAt(x, y);
+    if (tables.hotBecomes[material] != material) t = (int16_t)std::min<int>(t, tables.hotPoint[material] - TEMP_SCALE);
+    t = std::max(t, tables.coldPoint[material]);
+    if (t != AMBIENT) Heat(ctx, x, y);
+}
+
+// Applies the material's reactions to its 8 neighbours. Returns false once
+// the cell itself has turned into something else.
+static bool React(UpdateContext& ctx, Cell& cell, int x, int y) {
+    const Reaction* row = MATERIAL_TABLES.reactions[cell.material];
+    bool pending = false;
+
+    for (int dx = -1; dx <= 1; dx++) {
+        for (int dy = -1; dy <= 1; dy++) {
+            if (dx == 0 && dy == 0) continue;
+            int nx = x + dx, ny = y + dy;
+            if (nx < 0 || nx >= worldWidth || ny < 0 || ny >= worldHeight) continue;
+
+            Cell& n = CellAt(nx, ny);
+            const Reaction& r = row[n.material];
+            if (!r.chance) continue;
+            if (!Roll(ctx.rng, r.chance)) {
+                pending = true;   // try again next tick
+                continue;
+            }
+
+            if (r.other != n.material) {
+                Transform(ctx, nx, ny, r.other, r.lifeMin, r.lifeSpan);
+                Wake(&ctx, nx, ny);
+            }
+            if (r.self != cell.material) {
+                const MaterialProps& p = MATERIAL_TABLES.props[r.self];
+                Transform(ctx, x, y, r.self, p.lifeMin, p.lifeSpan);
+                Wake(&ctx, x, y);
+                return false;
             }
-            else if (c == FIRE) {
-                fireLife[x][y]--;
-                if (fireLife[x][y] <= 0) {
-                    grid[x][y] = AIR;
+        }
+    }
+    if (pending) Wake(&ctx, x, y);
+    return true;
+}
+
+// Farthest cell within `reach` towards dir that can be reached through
+// cells the material displaces; x itself if the first one is blocked
+static int SlideTarget(int x, int y, int dir, int reach, const uint8_t* displaces) {
+    int to = x;
+    for (int k = 1; k <= reach && displaces[MaterialAt(x + dir * k, y)]; k++) to = x + dir * k;
+    return to;
+}
+
+// Every material moves the same way, read from its row of the tables:
+// straight on in its direction, then diagonally, then sideways for the
+// ones with dispersion. Falling and rising differ only in direction.
+static void UpdateCell(UpdateContext& ctx, int x, int y) {
+    Cell& cell = CellAt(x, y);
+    if (cell.material == AIR || cell.updated) return;
+
+    const MaterialProps& p = MATERIAL_TABLES.props[cell.material];
+
+    if (p.decayChance) {
+        Wake(&ctx, x, y);   // decaying is a change every tick
+        if (Roll(ctx.rng, p.decayChance)) {
+            if (cell.life <= 1) {
+                const MaterialProps& d = MATERIAL_TABLES.props[p.decaysTo];
+                Transform(ctx, x, y, p.decaysTo, d.lifeMin, d.lifeSpan);
+                return;
+            }
+            cell.life--;
+        }
+    }
+
+    if (p.reactive && !React(ctx, cell, x, y)) return;
+    if (p.direction == 0) return;
+
+    const uint8_t* displaces = MATERIAL_TABLES.displaces[cell.material];
+    int ny = y + p.direction;
+    int tx = x, ty = y;
+    if (displaces[MaterialAt(x, ny)]) {
+        ty = ny;
+    } else {
+        int dir = ctx.rng.Coin() ? -1 : 1;
+        if (displaces[MaterialAt(x + dir, ny)]) {
+            tx = x + dir;
+            ty = ny;
+        } else if (displaces[MaterialAt(x - dir, ny)]) {
+            tx = x - dir;
+            ty = ny;
+        } else if (p.dispersion) {
+            tx = SlideTarget(x, y, dir, p.dispersion, displaces);
+        }
+    }
+    if (tx == x && ty == y) return;   // settled: sleeps until a neighbour changes
+
+    // Viscous materials only take some of their moves, but stay awake
+    if (!Roll(ctx.rng, p.moveChance)) {
+        Wake(&ctx, x, y);
+        return;
+    }
+    Move(ctx, x, y, tx, ty);
+}
+
+// Scratch copy of a chunk's temperatures and conductances with a one cell
+// border from its neighbours, so the stencil reads plain rows, plus the
+// drift and thresholds of every cell. The chunk starts at column HALO_X, which keeps
+// the centre loads aligned.
+static const int HALO_X = 8;
+static const int HALO_STRIDE = HALO_X + CHUNK_SIZE + 8;
+
+struct HeatScratch {
+    alignas(16) int16_t t[CHUNK_SIZE + 2][HALO_STRIDE];
+    alignas(16) int16_t k[CHUNK_SIZE + 2][HALO_STRIDE];
+    alignas(16) int16_t drift[CHUNK_SIZE][CHUNK_SIZE];
+    alignas(16) int16_t hot[CHUNK_SIZE][CHUNK_SIZE];
+    alignas(16) int16_t cold[CHUNK_SIZE][CHUNK_SIZE];
+    int16_t rightT[CHUNK_SIZE], rightK[CHUNK_SIZE];   // the faces the chunks to the right
+    int16_t downT[CHUNK_SIZE], downK[CHUNK_SIZE];     // and below step, to wake them
+};
+
+// A row or column of chunk (cx, cy), from cell index start in steps of
+// step, into the scratch at t and k in steps of stride. An unallocated
+// chunk is air at ambient; outside the world nothing conducts.
+static void GatherBorder(int cx, int cy, int start, int step, int16_t* t, int16_t* k, int stride) {
+    const Chunk* c = GetChunk(cx, cy);
+    bool inside = cx >= 0 && cy >= 0 && cx < chunksX && cy < chunksY;
+    for (int i = 0; i < CHUNK_SIZE; i++) {
+        t[i * stride] = c ? c->temp[start + i * step] : AMBIENT;
+        k[i * stride] = !inside ? 0 : MATERIAL_TABLES.conductance[c ? c->cells[start + i * step].material : (int)AIR];
+    }
+}
+
+static void GatherHeat(const Chunk& chunk, HeatScratch& s) {
+    const MaterialTables& tables = MATERIAL_TABLES;
+    const int cx = chunk.cx, cy = chunk.cy;
+    const int w = std::min(CHUNK_SIZE, worldWidth - cx * CHUNK_SIZE);
+    const int h = std::min(CHUNK_SIZE, worldHeight - cy * CHUNK_SIZE);
+    const int last = CHUNK_SIZE - 1;
+
+    for (int j = 0; j < CHUNK_SIZE; j++) {
+        const Cell* cells = chunk.cells + j * CHUNK_SIZE;
+        int16_t* t = s.t[j + 1] + HALO_X;
+        int16_t* k = s.k[j + 1] + HALO_X;
+        std::copy(chunk.temp + j * CHUNK_SIZE, chunk.temp + (j + 1) * CHUNK_SIZE, t);
+        for (int i = 0; i < CHUNK_SIZE; i++) {
+            int m = cells[i].material;
+            k[i] = tables.conductance[m];
+            s.drift[j][i] = tables.drift[m];
+            s.hot[j][i] = tables.hotPoint[m];
+            s.cold[j][i] = tables.coldPoint[m];
+        }
+        // Cells past the world's edge stay as they are
+        if (j >= h) std::fill(k, k + CHUNK_SIZE, (int16_t)0);
+        else std::fill(k + w, k + CHUNK_SIZE, (int16_t)0);
+    }
+
+    // The stencil has no diagonals, so the corners are never read. The
+    // faces to the right and below belong to the chunks there (Diffuse), so
+    // nothing conducts across them here; they are gathered on the side.
+    GatherBorder(cx, cy - 1, last * CHUNK_SIZE, 1, s.t[0] + HALO_X, s.k[0] + HALO_X, 1);
+    GatherBorder(cx - 1, cy, last, CHUNK_SIZE, s.t[1] + HALO_X - 1, s.k[1] + HALO_X - 1, HALO_STRIDE);
+    GatherBorder(cx + 1, cy, 0, CHUNK_SIZE, s.rightT, s.rightK, 1);
+    GatherBorder(cx, cy + 1, 0, 1, s.downT, s.downK, 1);
+    std::fill(s.t[CHUNK_SIZE + 1] + HALO_X, s.t[CHUNK_SIZE + 1] + HALO_X + CHUNK_SIZE, AMBIENT);
+    std::fill(s.k[CHUNK_SIZE + 1] + HALO_X, s.k[CHUNK_SIZE + 1] + HALO_X + CHUNK_SIZE, (int16_t)0);
+    for (int j = 1; j <= CHUNK_SIZE; j++) {
+        s.t[j][HALO_X + CHUNK_SIZE] = AMBIENT;
+        s.k[j][HALO_X + CHUNK_SIZE] = 0;
+    }
+}
+
+// Heat crossing one face: the difference scaled by the smaller of the two
+// conductances (k << 9, so at most 3/16 of it), truncated towards zero.
+// Both sides of a face compute the same amount, so heat is conserved, and
+// small differences stop flowing.
+static int Flux(int d, int k) {
+    int f = ((d < 0 ? -d : d) * k) >> 16;
+    return d < 0 ? -f : f;
+}
+
+#if defined(__SSE2__)
+static __m128i Flux(__m128i n, __m128i c, __m128i k) {
+    __m128i d = _mm_sub_epi16(n, c);
+    __m128i sign = _mm_srai_epi16(d, 15);
+    __m128i f = _mm_mulhi_epi16(_mm_sub_epi16(_mm_xor_si128(d, sign), sign), k);
+    return _mm_sub_epi16(_mm_xor_si128(f, sign), sign);
+}
+#endif
+
+// One explicit step of the heat equation over a warm chunk, then the
+// phase changes it caused. Neighbouring chunks take their steps on other
+// ticks, so each border face is stepped by one side only: a chunk steps
+// the faces to its left and above and gives the chunk across what it took,
+// which the checkerboard makes safe just like cell moves.
+static void Diffuse(UpdateContext& ctx) {
+    Chunk& chunk = *ctx.chunk;
+    HeatScratch s;
+    GatherHeat(chunk, s);
+
+    // Which edges moved: the chunks across them have heat coming in
+    bool changed = false, left = false, right = false, up = false, down = false;
+    uint32_t crossed[CHUNK_SIZE];   // per row, the cells past a threshold
+    for (int j = 0; j < CHUNK_SIZE; j++) {
+        const int16_t* t = s.t[j + 1] + HALO_X;
+        const int16_t* k = s.k[j + 1] + HALO_X;
+        int16_t* out = chunk.temp + j * CHUNK_SIZE;
+        crossed[j] = 0;
+#if defined(__SSE2__)
+        for (int i = 0; i < CHUNK_SIZE; i += 8) {
+            __m128i c = _mm_load_si128((const __m128i*)(t + i));
+            __m128i kc = _mm_load_si128((const __m128i*)(k + i));
+            __m128i sum = c;
+            sum = _mm_add_epi16(sum, Flux(_mm_loadu_si128((const __m128i*)(t + i - 1)), c,
+                                          _mm_min_epi16(kc, _mm_loadu_si128((const __m128i*)(k + i - 1)))));
+            sum = _mm_add_epi16(sum, Flux(_mm_loadu_si128((const __m128i*)(t + i + 1)), c,
+                                          _mm_min_epi16(kc, _mm_loadu_si128((const __m128i*)(k + i + 1)))));
+            sum = _mm_add_epi16(sum, Flux(_mm_load_si128((const __m128i*)(t + i - HALO_STRIDE)), c,
+                                          _mm_min_epi16(kc, _mm_load_si128((const __m128i*)(k + i - HALO_STRIDE)))));
+            sum = _mm_add_epi16(sum, Flux(_mm_load_si128((const __m128i*)(t + i + HALO_STRIDE)), c,
+                                          _mm_min_epi16(kc, _mm_load_si128((const __m128i*)(k + i + HALO_STRIDE)))));
+            __m128i drift = _mm_load_si128((const __m128i*)&s.drift[j][i]);
+            __m128i toAmbient = _mm_sub_epi16(_mm_set1_epi16(AMBIENT), c);
+            toAmbient = _mm_max_epi16(toAmbient, _mm_sub_epi16(_mm_setzero_si128(), drift));
+            sum = _mm_add_epi16(sum, _mm_min_epi16(toAmbient, drift));
+            _mm_storeu_si128((__m128i*)(out + i), sum);
+
+            // sum >= hot or sum < cold, one bit per cell
+            __m128i below = _mm_cmplt_epi16(sum, _mm_load_si128((const __m128i*)&s.hot[j][i]));
+            __m128i past = _mm_or_si128(_mm_xor_si128(below, _mm_set1_epi16(-1)),
+                                        _mm_cmplt_epi16(sum, _mm_load_si128((const __m128i*)&s.cold[j][i])));
+            crossed[j] |= (uint32_t)(_mm_movemask_epi8(_mm_packs_epi16(past, _mm_setzero_si128())) & 0xff) << i;
+
+            __m128i step = _mm_sub_epi16(sum, c);
+            step = _mm_max_epi16(step, _mm_sub_epi16(_mm_setzero_si128(), step));
+            int moved = _mm_movemask_epi8(_mm_cmpgt_epi16(step, _mm_set1_epi16(SETTLE_STEP - 1)));   // two bits per cell
+            if (!moved) continue;
+            changed = true;
+            left |= i == 0 && (moved & 0x0003);
+            right |= i == CHUNK_SIZE - 8 && (moved & 0xc000);
+            up |= j == 0;
+            down |= j == CHUNK_SIZE - 1;
+        }
+#else
+        for (int i = 0; i < CHUNK_SIZE; i++) {
+            int c = t[i], kc = k[i];
+            int sum = c + Flux(t[i - 1] - c, std::min<int>(kc, k[i - 1])) +
+                          Flux(t[i + 1] - c, std::min<int>(kc, k[i + 1])) +
+                          Flux(t[i - HALO_STRIDE] - c, std::min<int>(kc, k[i - HALO_STRIDE])) +
+                          Flux(t[i + HALO_STRIDE] - c, std::min<int>(kc, k[i + HALO_STRIDE]));
+            sum += std::min<int>(std::max<int>(AMBIENT - c, -s.drift[j][i]), s.drift[j][i]);
+            out[i] = (int16_t)sum;
+            if (sum >= s.hot[j][i] || sum < s.cold[j][i]) crossed[j] |= 1u << i;
+            if (std::abs(sum - c) < SETTLE_STEP) continue;
+            changed = true;
+            left |= i == 0;
+            right |= i == CHUNK_SIZE - 1;
+            up |= j == 0;
+            down |= j == CHUNK_SIZE - 1;
+        }
+#endif
+    }
+
+    // The other side of the faces to the left and above, from the same
+    // temperatures the stencil read
+    const int last = CHUNK_SIZE - 1;
+    if (Chunk* across = GetChunk(chunk.cx - 1, chunk.cy)) {
+        for (int j = 0; j < CHUNK_SIZE; j++) {
+            const int16_t* t = s.t[j + 1] + HALO_X;
+            const int16_t* k = s.k[j + 1] + HALO_X;
+            int f = Flux(t[-1] - t[0], std::min(k[-1], k[0]));
+            across->temp[j * CHUNK_SIZE + last] -= (int16_t)f;
+            left |= std::abs(f) >= SETTLE_STEP;
+        }
+    }
+    if (Chunk* across = GetChunk(chunk.cx, chunk.cy - 1)) {
+        const int16_t* t = s.t[1] + HALO_X;
+        const int16_t* k = s.k[1] + HALO_X;
+        for (int i = 0; i < CHUNK_SIZE; i++) {
+            int f = Flux(t[i - HALO_STRIDE] - t[i], std::min(k[i - HALO_STRIDE], k[i]));
+            across->temp[last * CHUNK_SIZE + i] -= (int16_t)f;
+            up |= std::abs(f) >= SETTLE_STEP;
+        }
+    }
+
+    // The faces to the right and below are stepped by the chunks across,
+    // which only step while warm. A difference that would move heat wakes
+    // them even when this chunk's edge holds still, as a heat source does.
+    for (int j = 0; j < CHUNK_SIZE; j++) {
+        const int16_t* t = s.t[j + 1] + HALO_X;
+        const int16_t* k = s.k[j + 1] + HALO_X;
+        right |= std::abs(Flux(s.rightT[j] - t[last], std::min(s.rightK[j], k[last]))) >= SETTLE_STEP;
+    }
+    for (int i = 0; i < CHUNK_SIZE; i++) {
+        const int16_t* t = s.t[CHUNK_SIZE] + HALO_X;
+        const int16_t* k = s.k[CHUNK_SIZE] + HALO_X;
+        down |= std::abs(Flux(s.downT[i] - t[i], std::min(s.downK[i], k[i]))) >= SETTLE_STEP;
+    }
+
+    // Materials past their melting, boiling or freezing points change
+    const MaterialTables& tables = MATERIAL_TABLES;
+    for (int j = 0; j < CHUNK_SIZE; j++) {
+        for (uint32_t bits = crossed[j]; bits; bits &= bits - 1) {
+            int i = 0;
+            while (!(bits >> i & 1)) i++;
+            int x = chunk.cx * CHUNK_SIZE + i, y = chunk.cy * CHUNK_SIZE + j;
+            int m = chunk.cells[j * CHUNK_SIZE + i].material;
+            int16_t& t = chunk.temp[j * CHUNK_SIZE + i];
+            changed = true;
+
+            int to;
+            if (t >= tables.hotPoint[m]) {
+                to = tables.hotBecomes[m];
+            } else {
+                to = tables.coldBecomes[m];
+                if (to == m) {   // a heat source is held at its temperature
+                    t = tables.coldPoint[m];
                     continue;
                 }
-                // Spread fire to nearby flammables (oil, sand)
-                for (int dx = -1; dx <= 1; dx++) {
-                    for (int dy = -1; dy <= 1; dy++) {
-                        if (dx == 0 && dy == 0) continue;
-                        int nx = x + dx, ny = y + dy;
-                        if (nx >= 0 && nx < GRID_WIDTH &&
-                            ny >= 0 && ny < GRID_HEIGHT) {
-                            if ((grid[nx][ny] == OIL || grid[nx][ny] == SAND) &&
-                                GetRandomValue(0, 10) < 4) {
-                                grid[nx][ny] = FIRE;
-                                fireLife[nx][ny] = 20 + GetRandomValue(0, 20);
-                            }
-                        }
-                    }
-                }
-                    // Fire rises
-                if (y > 0 && grid[x][y - 1] == AIR &&
-                    GetRandomValue(0, 2) == 0) {
-                    grid[x][y - 1] = FIRE;
-                    fireLife[x][y - 1] = fireLife[x][y] - 5;
-                    grid[x][y] = AIR;
-                }
             }
+            const MaterialProps& p = tables.props[to];
+            Transform(ctx, x, y, to, p.lifeMin, p.lifeSpan);
+            Wake(&ctx, x, y);
         }
     }
+
+    ctx.warm[1][1] |= changed;
+    ctx.warm[0][1] |= left;
+    ctx.warm[2][1] |= right;
+    ctx.warm[1][0] |= up;
+    ctx.warm[1][2] |= down;
+}
+
+static void UpdateChunk(UpdateContext& ctx) {
+    const Chunk& chunk = *ctx.chunk;
+    ctx.cx = chunk.cx;
+    ctx.cy = chunk.cy;
+    ctx.rng.Seed(MixSeed(simulationSeed ^ MixSeed(tickCount ^ MixSeed((uint64_t)chunk.cy * chunksX + chunk.cx))));
+
+    // Bottom-up with the updated bit, so a cell moves at most once per tick
+    const DirtyRect& r = chunk.current;
+    for (int y = r.maxY; y >= r.minY; y--) {
+        // Alternate the left-right scan each row for less bias
+        if (y % 2 == 0) {
+            for (int x = r.minX; x <= r.maxX; x++) UpdateCell(ctx, x, y);
+        } else {
+            for (int x = r.maxX; x >= r.minX; x--) UpdateCell(ctx, x, y);
+        }
+    }
+
+    if (chunk.warm) {
+        if ((chunk.cx + chunk.cy + tickCount) % HEAT_INTERVAL == 0) Diffuse(ctx);
+        else ctx.warm[1][1] = true;   // waiting for its turn
+    }
+}
+
+static bool AllAir(const Chunk& c) {
+    for (const Cell& cell : c.cells) {
+        if (cell.material != AIR) return false;
+    }
+    return true;
 }
 
-// Draw the grid to the screen image
-void DrawGrid(Image& screenImage) {
-    for (int x = 0; x < GRID_WIDTH; x++) {
-        for (int y = 0; y < GRID_HEIGHT; y++) {
-            Color col;
-            switch (grid[x][y]) {
-                case AIR:   col = {50, 100, 150, 255}; break;
-                case SAND:  col = {220, 190, 100, 255}; break;
-                case WATER: col = {50, 100, 220, 255}; break;
-                case STONE: col = {100, 100, 100, 255}; break;
-                case OIL:   col = {80, 50, 20, 255}; break;
-                case FIRE:
-                    col = {255, (unsigned char)(150 + GetRandomValue(-20,20)), 0, 255};
-                    break;
-                default: col = WHITE;
+// Update the simulation state.
+// Chunks run in four checkerboard phases by (cx % 2, cy % 2). Chunks in one
+// phase are a whole chunk apart, and a cell rule reaches at most one cell
+// past its own chunk, so they never touch the same cells. Each chunk draws
+// from its own generator seeded by (seed, tick, chunk), so the result does
+// not depend on the thread count or on which thread ran which chunk.
+void UpdateSimulation() {
+    if (!pool) pool.reset(new ThreadPool());
+
+    // What was woken last tick is what gets scanned now, and what warmed
+    // up is what diffuses
+    std::vector<Chunk*> active;
+    for (Chunk* c : live) {
+        c->current = c->next;
+        c->next = DirtyRect();
+        c->warm = c->warmNext;
+        c->warmNext = false;
+        if (c->current.Empty() && !c->warm) continue;
+        active.push_back(c);
+        if (c->current.Empty()) continue;
+        cellsScanned += (uint64_t)(c->current.maxX - c->current.minX + 1) * (c->current.maxY - c->current.minY + 1);
+    }
+    std::sort(active.begin(), active.end(), [](const Chunk* a, const Chunk* b) {
+        return a->cy != b->cy ? a->cy < b->cy : a->cx < b->cx;
+    });
+
+    // Anything an awake chunk can write to must exist before the threads
+    // start, so allocation (and copy-on-write for a snapshot in progress)
+    // never happens inside a phase. Being next to an awake chunk also keeps
+    // a chunk from being released.
+    for (const Chunk* c : active) {
+        for (int cy = std::max(c->cy - 1, 0); cy <= std::min(c->cy + 1, chunksY - 1); cy++)
+            for (int cx = std::max(c->cx - 1, 0); cx <= std::min(c->cx + 1, chunksX - 1); cx++)
+                EnsureChunk(cx, cy)->idleTicks = 0;
+    }
+
+    // Cells moved last tick were woken, so clearing the updated bit over the
+    // awake rectangles resets every bit that can be set. This has to finish
+    // before any phase runs: a chunk may move cells into its neighbours.
+    pool->ParallelFor((int)active.size(), [&](int k) {
+        const DirtyRect& r = active[k]->current;
+        for (int y = r.minY; y <= r.maxY; y++) {
+            for (int x = r.minX; x <= r.maxX; x++) CellAt(x, y).updated = 0;
+        }
+    });
+
+    contexts.resize(active.size());
+    std::vector<int> phaseTasks;
+    for (int phase = 0; phase < 4; phase++) {
+        phaseTasks.clear();
+        for (int k = 0; k < (int)active.size(); k++) {
+            if ((active[k]->cx & 1) == (phase & 1) && (active[k]->cy & 1) == (phase >> 1)) {
+                phaseTasks.push_back(k);
             }
+        }
+
+        pool->ParallelFor((int)phaseTasks.size(), [&](int t) {
+            int k = phaseTasks[t];
+            contexts[k].chunk = active[k];
+            UpdateChunk(contexts[k]);
+        });
+    }
 
-            for (int dx = 0; dx < CELL_SIZE; dx++) {
-                for (int dy = 0; dy < CELL_SIZE; dy++) {
-                    ImageDrawPixel(&screenImage,
-                        x * CELL_SIZE + dx,
-                        y * CELL_SIZE + dy,
-                        col);
+    // Merge every outbox into its target chunk (union, so order does not matter)
+    for (int k = 0; k < (int)active.size(); k++) {
+        UpdateContext& ctx = contexts[k];
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                if (Chunk* target = GetChunk(ctx.cx + i - 1, ctx.cy + j - 1)) {
+                    Merge(target->next, ctx.next[i][j]);
+                    Merge(target->redraw, ctx.redraw[i][j]);
+                    target->warmNext |= ctx.warm[i][j];
                 }
+                ctx.next[i][j] = DirtyRect();
+                ctx.redraw[i][j] = DirtyRect();
+                ctx.warm[i][j] = false;
             }
         }
     }
+
+    // Hand chunks that have been empty and asleep for a while back to the pool
+    for (size_t k = 0; k < live.size();) {
+        Chunk* c = live[k];
+        bool idle = c->current.Empty() && c->next.Empty() && !c->warm && !c->warmNext;
+        c->idleTicks = idle ? c->idleTicks + 1 : 0;
+        if (c->idleTicks >= RELEASE_TICKS && AllAir(*c)) {
+            BeforeWrite(*c);
+            chunkTable[c->cy * chunksX + c->cx] = nullptr;
+            chunkPool.Release(c);
+            live[k] = live.back();
+            live.pop_back();
+            continue;
+        }
+        k++;
+    }
+    tickCount++;
+}
+
+int ActiveChunkCount() {
+    int n = 0;
+    for (const Chunk* c : live) {
+        if (!c->current.Empty() || c->warm) n++;
+    }
+    return n;
+}
+
+int AllocatedChunkCount() {
+    return (int)live.size();
+}
+
+uint64_t SimulationCellsScanned() {
+    return cellsScanned;
 }
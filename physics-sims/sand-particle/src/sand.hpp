@@ -1,18 +1,97 @@
 #pragma once
-#include <raylib.h>
-#include <raymath.h>
+#include <climits>
+#include <cstdint>
+#include "materials.hpp"
 
-const int SCREEN_WIDTH  = 1200;
-const int SCREEN_HEIGHT = 600;
+// One grid cell packed into 16 bits
+struct Cell {
+    uint16_t material : 5;  // CellType
+    uint16_t life     : 6;  // ticks left for materials that decay (fire, steam)
+    uint16_t variant  : 4;  // colour variation, fixed when the cell is placed
+    uint16_t updated  : 1;  // already moved this tick
+};
+static_assert(sizeof(Cell) == 2, "Cell must pack into 16 bits");
 
-const int CELL_SIZE = 4;
-const int GRID_WIDTH  = SCREEN_WIDTH / CELL_SIZE;
-const int GRID_HEIGHT = SCREEN_HEIGHT / CELL_SIZE;
+inline Cell MakeCell(CellType material, int life = 0, int variant = 0) {
+    Cell c;
+    c.material = material;
+    c.life = life;
+    c.variant = variant;
+    c.updated = 0;
+    return c;
+}
 
-enum CellType { AIR = 0, SAND = 1, WATER = 2, STONE = 3, OIL = 4, FIRE = 5};
+// The world is a grid of chunks sized at runtime. A chunk is allocated from
+// a pool the first time something other than air lands in it, and goes back
+// once it has been all air and asleep for a while, so memory follows the
+// occupied area rather than the world bounds. Each chunk also tracks the
+// rectangle of cells that may change next tick; a chunk whose rectangle is
+// empty is asleep and is skipped by UpdateSimulation.
+//
+// Every cell also has a temperature that travels with it when it moves.
+// Heat spreads only through warm chunks: a chunk is warm for the next tick
+// while its temperatures are still changing, so a world at rest costs
+// nothing and a cooling lava flow costs one stencil pass per chunk.
+const int CHUNK_SHIFT = 5;
+const int CHUNK_SIZE  = 1 << CHUNK_SHIFT;
+const int CHUNK_MASK  = CHUNK_SIZE - 1;
+const int MAX_WORLD_SIZE = 16384;   // cells per side
 
-extern CellType grid[GRID_WIDTH][GRID_HEIGHT];
-extern int fireLife[GRID_WIDTH][GRID_HEIGHT];
+struct DirtyRect {
+    int minX = INT_MAX, minY = INT_MAX;  // inclusive world cell bounds,
+    int maxX = -1, maxY = -1;            // empty when min > max
 
+    bool Empty() const { return minX > maxX; }
+};
+
+struct Chunk {
+    int cx = 0, cy = 0;
+    Cell cells[CHUNK_SIZE * CHUNK_SIZE];  // row-major inside the chunk
+    int16_t temp[CHUNK_SIZE * CHUNK_SIZE];  // 1/TEMP_SCALE degrees C, same order
+    DirtyRect current;  // cells scanned this tick
+    DirtyRect next;     // cells woken for the next tick
+    DirtyRect redraw;   // cells changed since the renderer last looked
+    bool warm = false;      // heat diffuses this tick
+    bool warmNext = false;  // and next tick
+    int idleTicks = 0;  // consecutive ticks asleep
+    int snapshotSlot = -1;  // >= 0 while a snapshot being saved still shares the cells
+};
+
+// Replaces the world with width x height cells of air (clamped to MAX_WORLD_SIZE)
+void InitWorld(int width, int height);
+int WorldWidth();
+int WorldHeight();
+int ChunksX();
+int ChunksY();
+
+Chunk* GetChunk(int cx, int cy);        // nullptr: all air, not allocated
+Chunk* EnsureChunk(int cx, int cy);     // allocates if needed; the cells may be written
+Cell GetCell(int x, int y);             // AIR outside the world or unallocated
+void SetCell(int x, int y, Cell c);     // allocates as needed and wakes the cell; the
+                                        // cell starts at its material's base temperature
+float GetTemperature(int x, int y);     // degrees C; ambient where nothing is allocated
+
+// Call after changing a cell: wakes it and its 8 neighbours for the next tick
+void WakeCell(int x, int y);
+
+// Seeds the cell rules and starts the update threads (0: all hardware
+// threads). The same seed gives the same world for any thread count.
+void InitSimulation(uint64_t seed, int threads = 0);
+int SimulationThreads();
 void UpdateSimulation();
-void DrawGrid(Image& screenImage);
+
+// Seed and tick fix what every later tick does; a saved world stores them
+// and ResumeSimulation puts them back
+uint64_t SimulationSeed();
+uint64_t SimulationTick();
+void ResumeSimulation(uint64_t seed, uint64_t tick);
+
+// Copy-on-write for snapshots. The hook runs on the simulation thread
+// before anything writes to or releases a chunk whose snapshotSlot is set,
+// and must leave the snapshot with cells of its own.
+typedef void (*PreserveHook)(Chunk& c);
+void SetPreserveHook(PreserveHook hook);
+
+int ActiveChunkCount();
+int AllocatedChunkCount();
+uint64_t SimulationCellsScanned();   // cells in awake rectangles, summed over every tick
@@ -0,0 +1,96 @@
+#include "scenes.hpp"
+#include "sand.hpp"
+#include <cstring>
+
+static Cell Make(Rng& rng, CellType m) {
+    const MaterialProps& p = MATERIAL_TABLES.props[m];
+    int life = p.lifeMin + (p.lifeSpan ? rng.Below(p.lifeSpan + 1) : 0);
+    return MakeCell(m, life, m == AIR ? 0 : rng.Below(16));
+}
+
+static void Fill(Rng& rng, int x0, int y0, int x1, int y1, CellType m) {
+    for (int y = y0; y < y1; y++)
+        for (int x = x0; x < x1; x++)
+            SetCell(x, y, Make(rng, m));
+}
+
+static void Disc(Rng& rng, int cx, int cy, int r, CellType m) {
+    for (int dy = -r; dy <= r; dy++)
+        for (int dx = -r; dx <= r; dx++)
+            if (dx * dx + dy * dy <= r * r) SetCell(cx + dx, cy + dy, Make(rng, m));
+}
+
+static void Floor(Rng& rng) {
+    Fill(rng, 0, WorldHeight() - 4, WorldWidth(), WorldHeight(), STONE);
+}
+
+// Sand pile: three spouts pour for the first 600 ticks
+static void BuildPile(Rng& rng) {
+    Floor(rng);
+}
+
+static void FeedPile(Rng& rng, uint64_t tick) {
+    if (tick >= 600) return;
+    for (int k = 1; k <= 3; k++) {
+        int x = WorldWidth() * k / 4;
+        for (int dx = -4; dx <= 4; dx++) {
+            if (rng.Coin()) SetCell(x + dx, 2, Make(rng, SAND));
+        }
+    }
+}
+
+// Water tank: a full stone basin whose wall breaks after 100 ticks
+static void BuildTank(Rng& rng) {
+    const int w = WorldWidth(), h = WorldHeight();
+    Floor(rng);
+    Fill(rng, w / 8, h / 3, w / 8 + 4, h - 4, STONE);
+    Fill(rng, w / 2, h / 3, w / 2 + 4, h - 4, STONE);
+    Fill(rng, w / 8 + 4, h / 3 + 8, w / 2, h - 4, WATER);
+}
+
+static void FeedTank(Rng& rng, uint64_t tick) {
+    if (tick != 100) return;
+    const int w = WorldWidth(), h = WorldHeight();
+    Fill(rng, w / 2, h - 4 - h / 6, w / 2 + 4, h - 4, AIR);
+}
+
+// Oil fire: oil floating on water, lit in a few places
+static void BuildOilFire(Rng& rng) {
+    const int w = WorldWidth(), h = WorldHeight();
+    Floor(rng);
+    Fill(rng, 0, h - 4 - h / 8, w, h - 4, WATER);
+    Fill(rng, 0, h - 4 - h / 4, w, h - 4 - h / 8, OIL);
+    for (int k = 1; k < 8; k++) Disc(rng, w * k / 8, h - 4 - h / 4 - 3, 2, FIRE);
+}
+
+// Chaos: blobs of every material, and more dropped in for 300 ticks
+static void BuildChaos(Rng& rng) {
+    const int w = WorldWidth(), h = WorldHeight();
+    Floor(rng);
+    int blobs = w * h / 4000;
+    for (int i = 0; i < blobs; i++) {
+        CellType m = (CellType)(1 + rng.Below(MATERIAL_COUNT - 1));
+        Disc(rng, rng.Below(w), h / 4 + rng.Below(h * 3 / 4), 3 + rng.Below(10), m);
+    }
+}
+
+static void FeedChaos(Rng& rng, uint64_t tick) {
+    if (tick >= 300 || tick % 10 != 0) return;
+    CellType m = (CellType)(1 + rng.Below(MATERIAL_COUNT - 1));
+    Disc(rng, rng.Below(WorldWidth()), 8 + rng.Below(WorldHeight() / 4), 6, m);
+}
+
+const Scene SCENES[] = {
+    { "pile",    "sand poured onto a floor",       BuildPile,    FeedPile },
+    { "tank",    "water tank with a breaking wall", BuildTank,    FeedTank },
+    { "oilfire", "burning oil on water",           BuildOilFire, nullptr },
+    { "chaos",   "random blobs of every material", BuildChaos,   FeedChaos },
+};
+const int SCENE_COUNT = sizeof(SCENES) / sizeof(SCENES[0]);
+
+const Scene* FindScene(const char* name) {
+    for (const Scene& s : SCENES) {
+        if (strcmp(s.name, name) == 0) return &s;
+    }
+    return nullptr;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+#include "rng.hpp"
+
+// Reproducible test worlds for the benchmark. A scene fills the current
+// world (any size; everything is laid out relative to it) and may keep
+// adding material for a while, always from its own seeded generator, so
+// a scene, seed and tick count give the same world on every run.
+struct Scene {
+    const char* name;
+    const char* description;
+    void (*build)(Rng& rng);
+    void (*feed)(Rng& rng, uint64_t tick);   // before each tick; may be nullptr
+};
+
+extern const Scene SCENES[];
+extern const int SCENE_COUNT;
+
+const Scene* FindScene(const char* name);   // nullptr if there is none
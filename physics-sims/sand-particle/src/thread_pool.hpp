@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that run one batch of tasks at a time.
+// Tasks are handed out from a shared counter: a chunk update is cheap and
+// the batches are small, so there is nothing to gain from per-thread queues.
+// ParallelFor returns only when every task has finished, which makes it the
+// barrier between checkerboard phases. The caller works on the batch too.
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+
+    std::mutex mtx;
+    std::condition_variable start;
+    std::condition_variable finished;
+    const std::function<void(int)>* task = nullptr;
+    int taskCount = 0;
+    std::atomic<int> nextTask{0};
+    int running = 0;          // workers still inside the current batch
+    unsigned batch = 0;
+    bool stopping = false;
+
+    void Drain();
+    void WorkerLoop();
+
+public:
+    explicit ThreadPool(int threads = 0);  // 0: use every hardware thread
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int Size() const { return (int)workers.size() + 1; }
+    void ParallelFor(int count, const std::function<void(int)>& fn);
+};
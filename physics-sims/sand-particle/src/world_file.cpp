@@ -0,0 +1,401 @@
+#include "world_file.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+const int CHUNK_CELLS = CHUNK_SIZE * CHUNK_SIZE;
+
+// Records in the mapping are only byte aligned, so read through memcpy
+template <typename T>
+static T ReadAt(const uint8_t* p) {
+    T value;
+    memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+static uint16_t CellBits(Cell c) {
+    c.updated = 0;
+    c.variant = 0;
+    uint16_t v;
+    memcpy(&v, &c, sizeof(v));
+    return v;
+}
+
+// Cells and temperatures of a chunk, copied for a snapshot
+struct ChunkCopy {
+    Cell cells[CHUNK_CELLS];
+    int16_t temp[CHUNK_CELLS];
+};
+
+// PackBits over one chunk's worth of 16-bit units
+static void PackRuns(const uint16_t* v, std::vector<uint8_t>& out) {
+    auto put = [&out](uint16_t x) {
+        out.push_back((uint8_t)x);
+        out.push_back((uint8_t)(x >> 8));
+    };
+
+    int i = 0;
+    while (i < CHUNK_CELLS) {
+        int j = i + 1;
+        while (j < CHUNK_CELLS && j - i < 128 && v[j] == v[i]) j++;
+        if (j - i >= 2) {
+            out.push_back((uint8_t)(0x80 | (j - i - 1)));
+            put(v[i]);
+            i = j;
+            continue;
+        }
+
+        // Literals up to the next pair of equal units
+        j = i + 1;
+        while (j < CHUNK_CELLS && j - i < 128 && !(j + 1 < CHUNK_CELLS && v[j] == v[j + 1])) j++;
+        out.push_back((uint8_t)(j - i - 1));
+        for (int k = i; k < j; k++) put(v[k]);
+        i = j;
+    }
+}
+
+// Returns the end of the runs, or nullptr if they do not fit
+static const uint8_t* UnpackRuns(const uint8_t* p, const uint8_t* end, uint16_t* v) {
+    int n = 0;
+    while (n < CHUNK_CELLS) {
+        if (p >= end) return nullptr;
+        uint8_t tag = *p++;
+        int count = (tag & 0x7f) + 1;
+        int unitBytes = (tag & 0x80) ? 2 : 2 * count;
+        if (n + count > CHUNK_CELLS || end - p < unitBytes) return nullptr;
+
+        for (int k = 0; k < count; k++) {
+            const uint8_t* q = (tag & 0x80) ? p : p + 2 * k;
+            v[n + k] = (uint16_t)(q[0] | q[1] << 8);
+        }
+        p += unitBytes;
+        n += count;
+    }
+    return p;
+}
+
+// Returns false for a chunk that is all air at ambient temperature, unless
+// it is warm: heat may be about to flow into it
+static bool Encode(const Cell* cells, const int16_t* temp, bool warm, std::vector<uint8_t>& out) {
+    const int16_t ambient = AMBIENT_TEMP * TEMP_SCALE;
+    uint16_t v[CHUNK_CELLS];
+    bool any = false;
+    for (int i = 0; i < CHUNK_CELLS; i++) {
+        v[i] = CellBits(cells[i]);
+        any |= cells[i].material != AIR || temp[i] != ambient;
+    }
+    if (!any && !warm) return false;
+
+    out.clear();
+    PackRuns(v, out);
+
+    // Variants, two per byte
+    int n = 0;
+    for (int k = 0; k < CHUNK_CELLS; k++) {
+        if (cells[k].material == AIR) continue;
+        if (n++ % 2 == 0) out.push_back((uint8_t)cells[k].variant);
+        else out.back() |= (uint8_t)(cells[k].variant << 4);
+    }
+
+    for (int i = 0; i < CHUNK_CELLS; i++) v[i] = (uint16_t)temp[i];
+    PackRuns(v, out);
+    return true;
+}
+
+static bool Decode(const uint8_t* p, uint32_t bytes, Cell* cells, int16_t* temp) {
+    const uint8_t* end = p + bytes;
+    uint16_t v[CHUNK_CELLS];
+    p = UnpackRuns(p, end, v);
+    if (!p) return false;
+    memcpy(cells, v, sizeof(v));
+    for (int k = 0; k < CHUNK_CELLS; k++) {
+        if (cells[k].material >= MATERIAL_COUNT) return false;   // indexes every material table
+    }
+
+    int m = 0;
+    for (int k = 0; k < CHUNK_CELLS; k++) {
+        if (cells[k].material == AIR) continue;
+        if (p + m / 2 >= end) return false;
+        cells[k].variant = (p[m / 2] >> (4 * (m % 2))) & 15;
+        m++;
+    }
+    p += (m + 1) / 2;
+
+    if (UnpackRuns(p, end, v) != end) return false;
+    for (int i = 0; i < CHUNK_CELLS; i++) temp[i] = (int16_t)v[i];
+    return true;
+}
+
+// Who has a snapshot chunk, changed by compare-exchange: the writer
+// encodes straight from the live chunk if it gets there first, otherwise
+// the simulation thread copies the cells and temperatures before it first
+// writes to them
+enum : uint8_t { UNTOUCHED, WRITING, COPYING, COPIED, DONE };
+
+struct SnapshotChunk {
+    Chunk* chunk = nullptr;
+    uint16_t cx = 0, cy = 0;
+    uint8_t next[4] = {};
+    uint32_t flags = 0;
+    std::atomic<uint8_t> state{UNTOUCHED};
+    std::unique_ptr<ChunkCopy> copy;
+};
+
+struct Snapshot {
+    FILE* file = nullptr;
+    WorldFileHeader header = {};
+    std::unique_ptr<SnapshotChunk[]> chunks;
+    size_t count = 0;
+    std::atomic<bool> done{false};
+    bool ok = true;
+};
+
+// Kept until the next save: chunks never written since still point into it
+static std::unique_ptr<Snapshot> snapshot;
+static std::thread writer;
+
+static void Preserve(Chunk& c) {
+    SnapshotChunk& s = snapshot->chunks[c.snapshotSlot];
+    uint8_t expected = UNTOUCHED;
+    if (s.state.compare_exchange_strong(expected, COPYING, std::memory_order_acquire)) {
+        s.copy.reset(new ChunkCopy());
+        memcpy(s.copy->cells, c.cells, sizeof(c.cells));
+        memcpy(s.copy->temp, c.temp, sizeof(c.temp));
+        s.state.store(COPIED, std::memory_order_release);
+    } else {
+        // The writer is encoding straight from the chunk; a record takes
+        // microseconds, so waiting is cheaper than copying
+        while (s.state.load(std::memory_order_acquire) == WRITING) std::this_thread::yield();
+    }
+    c.snapshotSlot = -1;
+}
+
+static void WriteSnapshot(Snapshot* s) {
+    std::vector<WorldChunkEntry> index;
+    std::vector<uint8_t> record;
+    uint64_t offset = sizeof(WorldFileHeader);
+
+    fwrite(&s->header, sizeof(s->header), 1, s->file);
+    for (size_t i = 0; i < s->count; i++) {
+        SnapshotChunk& sc = s->chunks[i];
+        uint8_t expected = UNTOUCHED;
+        bool shared = sc.state.compare_exchange_strong(expected, WRITING, std::memory_order_acquire);
+        if (!shared) {
+            while (sc.state.load(std::memory_order_acquire) == COPYING) std::this_thread::yield();
+        }
+
+        bool warm = (sc.flags & CHUNK_WARM) != 0;
+        bool stored = shared ? Encode(sc.chunk->cells, sc.chunk->temp, warm, record)
+                             : Encode(sc.copy->cells, sc.copy->temp, warm, record);
+        if (shared) {
+            sc.state.store(DONE, std::memory_order_release);
+        } else {
+            sc.copy.reset();
+        }
+        if (!stored) continue;
+
+        WorldChunkEntry e = {};
+        e.cx = sc.cx;
+        e.cy = sc.cy;
+        e.bytes = (uint32_t)record.size();
+        e.offset = offset;
+        memcpy(e.next, sc.next, sizeof(e.next));
+        e.flags = sc.flags;
+        index.push_back(e);
+
+        fwrite(record.data(), 1, record.size(), s->file);
+        offset += record.size();
+    }
+
+    WorldFileFooter footer = { offset, (uint32_t)index.size(), WORLD_FOOTER };
+    fwrite(index.data(), sizeof(WorldChunkEntry), index.size(), s->file);
+    fwrite(&footer, sizeof(footer), 1, s->file);
+    s->ok = !ferror(s->file);
+    s->ok &= fclose(s->file) == 0;
+    s->file = nullptr;
+    s->done = true;
+}
+
+bool SaveWorld(const std::string& path) {
+    if (SaveInProgress()) return false;
+    FinishSave();
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "SaveWorld: cannot open " << path << std::endl;
+        return false;
+    }
+
+    std::unique_ptr<Snapshot> s(new Snapshot());
+    s->file = file;
+    s->header = { WORLD_MAGIC, (uint32_t)WorldWidth(), (uint32_t)WorldHeight(), (uint32_t)CHUNK_SHIFT,
+                  SimulationSeed(), SimulationTick() };
+
+    // Capturing is only bookkeeping: no cells are copied here. Walking the
+    // table in row order leaves the index sorted.
+    std::vector<Chunk*> chunks;
+    for (int cy = 0; cy < ChunksY(); cy++) {
+        for (int cx = 0; cx < ChunksX(); cx++) {
+            if (Chunk* c = GetChunk(cx, cy)) chunks.push_back(c);
+        }
+    }
+    s->count = chunks.size();
+    s->chunks.reset(new SnapshotChunk[chunks.size()]);
+    for (size_t i = 0; i < chunks.size(); i++) {
+        Chunk* c = chunks[i];
+        SnapshotChunk& sc = s->chunks[i];
+        sc.chunk = c;
+        sc.cx = (uint16_t)c->cx;
+        sc.cy = (uint16_t)c->cy;
+        if (c->next.Empty()) {
+            memset(sc.next, 255, sizeof(sc.next));
+        } else {
+            sc.next[0] = (uint8_t)(c->next.minX - c->cx * CHUNK_SIZE);
+            sc.next[1] = (uint8_t)(c->next.minY - c->cy * CHUNK_SIZE);
+            sc.next[2] = (uint8_t)(c->next.maxX - c->cx * CHUNK_SIZE);
+            sc.next[3] = (uint8_t)(c->next.maxY - c->cy * CHUNK_SIZE);
+        }
+        sc.flags = c->warmNext ? CHUNK_WARM : 0;
+        c->snapshotSlot = (int)i;
+    }
+
+    snapshot = std::move(s);
+    SetPreserveHook(Preserve);
+    writer = std::thread(WriteSnapshot, snapshot.get());
+    return true;
+}
+
+bool SaveInProgress() {
+    return snapshot && !snapshot->done;
+}
+
+bool FinishSave() {
+    if (writer.joinable()) writer.join();
+    return !snapshot || snapshot->ok;
+}
+
+bool LoadWorld(const std::string& path) {
+    FinishSave();
+
+    WorldFile file;
+    if (!file.Open(path)) return false;
+
+    const WorldFileHeader& h = file.Header();
+    InitWorld((int)h.width, (int)h.height);
+    ResumeSimulation(h.seed, h.tick);
+    file.LoadRegion(0, 0, ChunksX() - 1, ChunksY() - 1);
+    return true;
+}
+
+bool WorldFile::Open(const std::string& path) {
+    Close();
+
+    if (!file.Open(path)) {
+        std::cerr << "WorldFile: cannot map " << path << std::endl;
+        return false;
+    }
+
+    bool valid = file.Size() >= sizeof(WorldFileHeader) + sizeof(WorldFileFooter);
+    if (valid) {
+        header = ReadAt<WorldFileHeader>(file.Data());
+        WorldFileFooter footer = ReadAt<WorldFileFooter>(file.Data() + file.Size() - sizeof(WorldFileFooter));
+        uint64_t indexEnd = footer.indexOffset + (uint64_t)footer.chunkCount * sizeof(WorldChunkEntry);
+        valid = header.magic == WORLD_MAGIC && header.chunkShift == (uint32_t)CHUNK_SHIFT &&
+                header.width > 0 && header.width <= (uint32_t)MAX_WORLD_SIZE &&
+                header.height > 0 && header.height <= (uint32_t)MAX_WORLD_SIZE &&
+                footer.magic == WORLD_FOOTER &&
+                indexEnd + sizeof(WorldFileFooter) == file.Size();
+        index = file.Data() + footer.indexOffset;
+        chunkCount = footer.chunkCount;
+    }
+    if (!valid) {
+        std::cerr << "WorldFile: " << path << " is not a saved world" << std::endl;
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void WorldFile::Close() {
+    file.Close();
+    header = {};
+    index = nullptr;
+    chunkCount = 0;
+}
+
+WorldChunkEntry WorldFile::Entry(uint32_t i) const {
+    return ReadAt<WorldChunkEntry>(index + (size_t)i * sizeof(WorldChunkEntry));
+}
+
+int WorldFile::LoadRegion(int minCx, int minCy, int maxCx, int maxCy) const {
+    if (!IsOpen()) return 0;
+    if ((int)header.width != WorldWidth() || (int)header.height != WorldHeight()) {
+        std::cerr << "WorldFile: world is " << WorldWidth() << "x" << WorldHeight()
+                  << ", file is " << header.width << "x" << header.height << std::endl;
+        return 0;
+    }
+
+    minCx = std::max(minCx, 0);
+    maxCx = std::min(maxCx, ChunksX() - 1);
+    const uint64_t recordsEnd = (const uint8_t*)index - file.Data();
+    int loaded = 0;
+
+    for (int cy = std::max(minCy, 0); cy <= std::min(maxCy, ChunksY() - 1); cy++) {
+        // First entry at or after (cy, minCx)
+        uint32_t lo = 0, hi = chunkCount;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            WorldChunkEntry e = Entry(mid);
+            if (e.cy < cy || (e.cy == cy && e.cx < minCx)) lo = mid + 1; else hi = mid;
+        }
+
+        for (uint32_t i = lo; i < chunkCount; i++) {
+            WorldChunkEntry e = Entry(i);
+            if (e.cy != cy || e.cx > maxCx) break;
+            if (e.cx < minCx) {   // out of order: not a chunk of this region
+                std::cerr << "WorldFile: chunk " << e.cx << "," << e.cy << " is out of order" << std::endl;
+                continue;
+            }
+
+            // The wake rectangle drives the next update's cell loops, so it
+            // has to lie inside the chunk and the world
+            const int x0 = e.cx * CHUNK_SIZE, y0 = e.cy * CHUNK_SIZE;
+            const bool asleep = e.next[0] == 255;
+            const bool nextValid = asleep ||
+                (e.next[0] <= e.next[2] && e.next[1] <= e.next[3] &&
+                 e.next[2] < CHUNK_SIZE && e.next[3] < CHUNK_SIZE &&
+                 x0 + e.next[2] < WorldWidth() && y0 + e.next[3] < WorldHeight());
+
+            Chunk* c = EnsureChunk(e.cx, e.cy);
+            if (e.offset > recordsEnd || e.bytes > recordsEnd - e.offset || !nextValid ||
+                !Decode(file.Data() + e.offset, e.bytes, c->cells, c->temp)) {
+                std::cerr << "WorldFile: chunk " << e.cx << "," << e.cy << " is damaged" << std::endl;
+                std::fill(std::begin(c->cells), std::end(c->cells), MakeCell(AIR));
+                std::fill(std::begin(c->temp), std::end(c->temp), (int16_t)(AMBIENT_TEMP * TEMP_SCALE));
+                continue;
+            }
+
+            c->current = DirtyRect();
+            c->next = DirtyRect();
+            if (!asleep) {
+                c->next.minX = x0 + e.next[0];
+                c->next.minY = y0 + e.next[1];
+                c->next.maxX = x0 + e.next[2];
+                c->next.maxY = y0 + e.next[3];
+            }
+            c->redraw.minX = x0;
+            c->redraw.minY = y0;
+            c->redraw.maxX = std::min(x0 + CHUNK_SIZE, WorldWidth()) - 1;
+            c->redraw.maxY = std::min(y0 + CHUNK_SIZE, WorldHeight()) - 1;
+            c->warm = false;
+            c->warmNext = (e.flags & CHUNK_WARM) != 0;
+            c->idleTicks = 0;
+            loaded++;
+        }
+    }
+    return loaded;
+}
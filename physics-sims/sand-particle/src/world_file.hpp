@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mapped_file.hpp"
+#include "sand.hpp"
+
+// Saved sand world.
+//
+// File layout (little endian):
+//   WorldFileHeader
+//   chunk records       cells of one chunk, PackBits coded
+//   chunk index         WorldChunkEntry per record, sorted by (cy, cx)
+//   WorldFileFooter     last bytes of the file
+//
+// Only chunks holding something other than air at ambient temperature, or
+// still warm, are stored. A record is the chunk's cells with the variant cleared, PackBits
+// coded as 16-bit units: a byte n < 128 followed by n + 1 literal cells, or
+// a byte 128 + n followed by one cell repeated n + 1 times. The variants of
+// the cells that are not air follow, two per byte; they are random, and
+// left in the cells they would break every run. Last come the cell
+// temperatures, PackBits coded the same way. Records are independent, so
+// any region can be decoded straight out of a mapping without touching the
+// rest of the file.
+const uint32_t WORLD_MAGIC  = 0x32574e53;   // "SNW2"
+const uint32_t WORLD_FOOTER = 0x58444957;   // "WIDX"
+
+struct WorldFileHeader {
+    uint32_t magic;
+    uint32_t width, height;
+    uint32_t chunkShift;
+    uint64_t seed;
+    uint64_t tick;
+};
+
+struct WorldChunkEntry {
+    uint16_t cx, cy;
+    uint32_t bytes;
+    uint64_t offset;
+    uint8_t next[4];    // wake rectangle inside the chunk (minX, minY, maxX, maxY), 255: asleep
+    uint32_t flags;     // CHUNK_WARM
+};
+
+const uint32_t CHUNK_WARM = 1;   // heat was still spreading
+
+struct WorldFileFooter {
+    uint64_t indexOffset;
+    uint32_t chunkCount;
+    uint32_t magic;
+};
+
+// Starts saving the current world to path and returns at once. The world
+// is captured as it is now: chunks are shared with the writer thread and
+// only copied if the simulation writes to them before the writer gets
+// there. Returns false if the file cannot be created or a save is still
+// running.
+bool SaveWorld(const std::string& path);
+bool SaveInProgress();
+bool FinishSave();   // waits for the writer; true if the last save completed
+
+// Replaces the current world, and the simulation's seed and tick, with
+// the contents of path
+bool LoadWorld(const std::string& path);
+
+// Random access to a saved world. The file is memory mapped and chunks
+// are found through the index, so loading a region reads only its records.
+class WorldFile {
+private:
+    MappedFile file;
+    WorldFileHeader header = {};
+    const uint8_t* index = nullptr;
+    uint32_t chunkCount = 0;
+
+    WorldChunkEntry Entry(uint32_t i) const;
+
+public:
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() const { return file.IsOpen(); }
+    const WorldFileHeader& Header() const { return header; }
+    uint32_t ChunkCount() const { return chunkCount; }
+
+    // Copies the stored chunks in the chunk range [minCx, maxCx] x [minCy,
+    // maxCy] into the current world, which must be the file's size.
+    // Stored chunks resume their saved wake state; chunks the file does not
+    // hold are left as they are. Returns the number of chunks loaded.
+    int LoadRegion(int minCx, int minCy, int maxCx, int maxCy) const;
+};